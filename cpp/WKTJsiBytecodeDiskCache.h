@@ -0,0 +1,264 @@
+#pragma once
+
+#include <jsi/jsi.h>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <utility>
+
+namespace RNWorklet {
+
+namespace jsi = facebook::jsi;
+
+/**
+ Directory of compiled worklet bytecode that survives app launches. Entries
+ are named by the worklet hash and the bytecode version of the engine, and
+ start with a header holding a checksum of the source they were compiled from
+ and of the bytecode. Entries are memory mapped when loaded, and entries that
+ are truncated, corrupt or compiled from other source are deleted.
+
+ The cache only stores and validates bytes, compiling and evaluating is left
+ to the caller. It is disabled until a directory is set.
+ */
+class JsiBytecodeDiskCache {
+public:
+  struct Stats {
+    size_t hits = 0;
+    size_t misses = 0;
+    size_t invalid = 0;
+    size_t writes = 0;
+
+    jsi::Object toObject(jsi::Runtime &runtime) const {
+      jsi::Object result(runtime);
+      result.setProperty(runtime, "hits", static_cast<double>(hits));
+      result.setProperty(runtime, "misses", static_cast<double>(misses));
+      result.setProperty(runtime, "invalid", static_cast<double>(invalid));
+      result.setProperty(runtime, "writes", static_cast<double>(writes));
+      return result;
+    }
+  };
+
+  /**
+   Returns the cache, which is never destroyed
+   */
+  static JsiBytecodeDiskCache &getInstance() {
+    static auto instance = new JsiBytecodeDiskCache();
+    return *instance;
+  }
+
+  /**
+   Sets the directory to store bytecode in. An empty path disables the cache.
+   The directory must exist.
+   */
+  void setDirectory(const std::string &directory) {
+    std::lock_guard<std::mutex> lock(_mutex);
+    _directory = directory;
+  }
+
+  bool isEnabled() {
+    std::lock_guard<std::mutex> lock(_mutex);
+    return !_directory.empty();
+  }
+
+  /**
+   Maps the bytecode of a worklet
+   @param hash Hash of the worklet
+   @param source Source the bytecode must have been compiled from
+   @param engineVersion Bytecode version of the engine
+   @return The bytecode, or nullptr if there is no valid entry
+   */
+  std::shared_ptr<const jsi::Buffer>
+  load(double hash, const std::string &source, uint32_t engineVersion) {
+    auto path = getPath(hash, engineVersion);
+    if (path.empty()) {
+      return nullptr;
+    }
+
+    auto fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+      countMiss();
+      return nullptr;
+    }
+    struct stat info;
+    void *data = MAP_FAILED;
+    if (fstat(fd, &info) == 0 &&
+        static_cast<size_t>(info.st_size) >= sizeof(Header)) {
+      data = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    }
+    close(fd);
+
+    if (data == MAP_FAILED) {
+      invalidate(path);
+      return nullptr;
+    }
+    auto buffer =
+        std::make_shared<MappedBuffer>(data, static_cast<size_t>(info.st_size));
+    if (!isValid(*buffer, source, engineVersion)) {
+      invalidate(path);
+      return nullptr;
+    }
+
+    std::lock_guard<std::mutex> lock(_mutex);
+    _stats.hits++;
+    return buffer;
+  }
+
+  /**
+   Writes the bytecode of a worklet. The entry is written to a temporary file
+   and renamed, so readers never see a partial entry.
+   @return False if the entry could not be written
+   */
+  bool store(double hash, const std::string &source, uint32_t engineVersion,
+             const std::string &bytecode) {
+    auto path = getPath(hash, engineVersion);
+    if (path.empty()) {
+      return false;
+    }
+
+    Header header;
+    std::memcpy(header.magic, Magic, sizeof(header.magic));
+    header.formatVersion = FormatVersion;
+    header.engineVersion = engineVersion;
+    header.sourceChecksum = checksum(source.data(), source.size());
+    header.payloadSize = bytecode.size();
+    header.payloadChecksum = checksum(bytecode.data(), bytecode.size());
+
+    std::stringstream tempPath;
+    tempPath << path << ".tmp" << getpid() << "-" << std::this_thread::get_id();
+    auto file = std::fopen(tempPath.str().c_str(), "wb");
+    if (file == nullptr) {
+      return false;
+    }
+    auto written = std::fwrite(&header, sizeof(header), 1, file) == 1 &&
+                   std::fwrite(bytecode.data(), 1, bytecode.size(), file) ==
+                       bytecode.size();
+    if (std::fclose(file) != 0 || !written ||
+        std::rename(tempPath.str().c_str(), path.c_str()) != 0) {
+      std::remove(tempPath.str().c_str());
+      return false;
+    }
+
+    std::lock_guard<std::mutex> lock(_mutex);
+    _stats.writes++;
+    return true;
+  }
+
+  Stats getStats() {
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _stats;
+  }
+
+private:
+  static constexpr char Magic[8] = {'W', 'K', 'T', 'B', 'C', 'O', 'D', 'E'};
+  static constexpr uint32_t FormatVersion = 1;
+
+  /**
+   Entry header. Its size keeps the bytecode after it aligned for engines
+   that read bytecode in place.
+   */
+  struct alignas(8) Header {
+    char magic[8];
+    uint32_t formatVersion;
+    uint32_t engineVersion;
+    uint64_t sourceChecksum;
+    uint64_t payloadSize;
+    uint64_t payloadChecksum;
+    uint8_t reserved[24] = {};
+  };
+
+  static_assert(sizeof(Header) == 64, "Header must be 64 bytes.");
+
+  /**
+   Bytecode in a mapped entry, the header is skipped
+   */
+  class MappedBuffer : public jsi::Buffer {
+  public:
+    MappedBuffer(void *data, size_t size) : _data(data), _size(size) {}
+
+    ~MappedBuffer() override { munmap(_data, _size); }
+
+    size_t size() const override { return _size - sizeof(Header); }
+
+    const uint8_t *data() const override {
+      return static_cast<const uint8_t *>(_data) + sizeof(Header);
+    }
+
+    const Header &header() const { return *static_cast<const Header *>(_data); }
+
+  private:
+    void *_data;
+    size_t _size;
+  };
+
+  /**
+   64 bit FNV-1a, stable across launches and builds
+   */
+  static uint64_t checksum(const void *data, size_t size) {
+    auto bytes = static_cast<const uint8_t *>(data);
+    uint64_t hash = 14695981039346656037ULL;
+    for (size_t i = 0; i < size; i++) {
+      hash ^= bytes[i];
+      hash *= 1099511628211ULL;
+    }
+    return hash;
+  }
+
+  static bool isValid(const MappedBuffer &buffer, const std::string &source,
+                      uint32_t engineVersion) {
+    auto &header = buffer.header();
+    return std::memcmp(header.magic, Magic, sizeof(header.magic)) == 0 &&
+           header.formatVersion == FormatVersion &&
+           header.engineVersion == engineVersion &&
+           header.payloadSize == buffer.size() &&
+           header.sourceChecksum == checksum(source.data(), source.size()) &&
+           header.payloadChecksum == checksum(buffer.data(), buffer.size());
+  }
+
+  /**
+   Returns the path of an entry, or an empty string if the cache is disabled.
+   Entries are named by the bits of the hash, which is defined for every
+   double unlike converting it to an integer.
+   */
+  std::string getPath(double hash, uint32_t engineVersion) {
+    std::lock_guard<std::mutex> lock(_mutex);
+    if (_directory.empty()) {
+      return "";
+    }
+    uint64_t hashBits;
+    static_assert(sizeof(hashBits) == sizeof(hash), "Expected 64 bit doubles.");
+    std::memcpy(&hashBits, &hash, sizeof(hashBits));
+    std::stringstream path;
+    path << _directory << "/" << std::hex << hashBits << "-" << std::dec
+         << engineVersion << ".wbc";
+    return path.str();
+  }
+
+  void countMiss() {
+    std::lock_guard<std::mutex> lock(_mutex);
+    _stats.misses++;
+  }
+
+  void invalidate(const std::string &path) {
+    std::remove(path.c_str());
+    std::lock_guard<std::mutex> lock(_mutex);
+    _stats.invalid++;
+    _stats.misses++;
+  }
+
+  std::mutex _mutex;
+  std::string _directory;
+  Stats _stats;
+};
+
+} // namespace RNWorklet
@@ -0,0 +1,163 @@
+#pragma once
+
+#include <jsi/jsi.h>
+
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+
+#include "WKTJsRuntimeFactory.h"
+#include "WKTJsiBytecodeDiskCache.h"
+#include "WKTJsiWorkletFunctionCache.h"
+
+#if JS_RUNTIME_HERMES && __has_include(<hermes/CompileJS.h>)
+#include <hermes/CompileJS.h>
+#define WKT_BYTECODE_DISK_CACHE 1
+#endif
+
+namespace RNWorklet {
+
+namespace jsi = facebook::jsi;
+
+/**
+ Cache of worklet code prepared with jsi::Runtime::prepareJavaScript, keyed by
+ the worklet hash. On Hermes, preparing compiles the source to bytecode, and
+ the prepared script does not belong to a runtime. Every worklet is then
+ compiled once, and all runtimes evaluate the same bytecode.
+
+ Other runtimes, like JSC, only wrap the source when preparing, so worklet
+ code is evaluated from source on them.
+
+ When Hermes is built with its compiler and a bytecode directory is set, the
+ bytecode is also written to the JsiBytecodeDiskCache, and later launches map
+ it from there instead of compiling.
+ */
+class JsiPreparedScriptCache {
+public:
+  static constexpr size_t DefaultCapacity = 512;
+
+  /**
+   Returns the cache, which is never destroyed
+   */
+  static JsiPreparedScriptCache &getInstance() {
+    static auto instance = new JsiPreparedScriptCache();
+    return *instance;
+  }
+
+  /**
+   Returns true if scripts prepared by the runtime can be shared
+   */
+  static bool canSharePreparedScripts(jsi::Runtime &runtime) {
+    return runtime.description().find("Hermes") != std::string::npos;
+  }
+
+  /**
+   Evaluates the code of a worklet, using the prepared script when the
+   runtime supports sharing them
+   @param runtime Runtime to evaluate in
+   @param hash Hash of the worklet
+   @param code Source to evaluate
+   @param sourceUrl Location of the source
+   */
+  jsi::Value evaluate(jsi::Runtime &runtime, double hash,
+                      const std::string &code, const std::string &sourceUrl) {
+    if (!canSharePreparedScripts(runtime)) {
+      return runtime.evaluateJavaScript(
+          std::make_shared<const jsi::StringBuffer>(code), sourceUrl);
+    }
+    auto description = runtime.description();
+    auto prepared = find(hash, code, description);
+    if (prepared == nullptr) {
+      prepared = prepare(runtime, hash, code, sourceUrl);
+      add(hash, code, description, prepared);
+    }
+    return runtime.evaluatePreparedJavaScript(prepared);
+  }
+
+  JsiWorkletFunctionCache::Stats getStats() {
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _stats;
+  }
+
+private:
+  /**
+   Prepares worklet code, from bytecode on disk when available
+   */
+  std::shared_ptr<const jsi::PreparedJavaScript>
+  prepare(jsi::Runtime &runtime, double hash, const std::string &code,
+          const std::string &sourceUrl) {
+#if WKT_BYTECODE_DISK_CACHE
+    auto &diskCache = JsiBytecodeDiskCache::getInstance();
+    if (diskCache.isEnabled()) {
+      auto version = facebook::hermes::HermesRuntime::getBytecodeVersion();
+      auto bytecode = diskCache.load(hash, code, version);
+      if (bytecode == nullptr) {
+        std::string compiled;
+        if (hermes::compileJS(code, compiled, true)) {
+          diskCache.store(hash, code, version, compiled);
+          bytecode =
+              std::make_shared<const jsi::StringBuffer>(std::move(compiled));
+        }
+      }
+      if (bytecode != nullptr) {
+        return runtime.prepareJavaScript(bytecode, sourceUrl);
+      }
+    }
+#endif
+    return runtime.prepareJavaScript(
+        std::make_shared<const jsi::StringBuffer>(code), sourceUrl);
+  }
+
+  struct Entry {
+    double hash;
+    std::string code;
+    // Scripts can only be evaluated by the kind of runtime that prepared them
+    std::string description;
+    std::shared_ptr<const jsi::PreparedJavaScript> prepared;
+  };
+
+  std::shared_ptr<const jsi::PreparedJavaScript>
+  find(double hash, const std::string &code, const std::string &description) {
+    std::lock_guard<std::mutex> lock(_mutex);
+    auto it = _index.find(hash);
+    if (it == _index.end() || it->second->code != code ||
+        it->second->description != description) {
+      _stats.misses++;
+      return nullptr;
+    }
+    _entries.splice(_entries.begin(), _entries, it->second);
+    _stats.hits++;
+    return it->second->prepared;
+  }
+
+  void add(double hash, const std::string &code, const std::string &description,
+           std::shared_ptr<const jsi::PreparedJavaScript> prepared) {
+    std::lock_guard<std::mutex> lock(_mutex);
+    auto it = _index.find(hash);
+    if (it != _index.end()) {
+      _entries.erase(it->second);
+      _index.erase(it);
+      _stats.size--;
+    }
+    _entries.push_front({hash, code, description, prepared});
+    _index.emplace(hash, _entries.begin());
+    _stats.size++;
+    while (_entries.size() > DefaultCapacity) {
+      _index.erase(_entries.back().hash);
+      _entries.pop_back();
+      _stats.size--;
+      _stats.evictions++;
+    }
+  }
+
+  std::mutex _mutex;
+  JsiWorkletFunctionCache::Stats _stats;
+  // Most recently used first
+  std::list<Entry> _entries;
+  std::unordered_map<double, std::list<Entry>::iterator> _index;
+};
+
+} // namespace RNWorklet
@@ -2,13 +2,18 @@
 
 #include <jsi/jsi.h>
 
+#include <atomic>
+#include <functional>
 #include <memory>
+#include <mutex>
 #include <string>
 #include <utility>
 #include <vector>
 
 #include "WKTJsiHostObject.h"
+#include "WKTJsiPreparedScriptCache.h"
 #include "WKTJsiWorkletContext.h"
+#include "WKTJsiWorkletFunctionCache.h"
 #include "WKTJsiWrapper.h"
 #include "WKTRuntimeAwareCache.h"
 
@@ -47,25 +52,6 @@ private:
   std::string _stack;
 };
 
-/**
-  Class for wrapping jsThis when executing worklets
-  */
-class JsThisWrapper {
-public:
-  JsThisWrapper(jsi::Runtime &runtime, const jsi::Object &thisValue) {
-    _oldThis = runtime.global().getProperty(runtime, PropNameJsThis);
-    runtime.global().setProperty(runtime, PropNameJsThis, thisValue);
-    _runtime = &runtime;
-  }
-  ~JsThisWrapper() {
-    _runtime->global().setProperty(*_runtime, PropNameJsThis, _oldThis);
-  }
-
-private:
-  jsi::Value _oldThis;
-  jsi::Runtime *_runtime;
-};
-
 /**
  Encapsulates a runnable function. A runnable function is a function
  that exists in both the main JS runtime and as an installed function
@@ -74,12 +60,25 @@ private:
  */
 class JsiWorklet : public JsiHostObject,
                    public std::enable_shared_from_this<JsiWorklet> {
+  /**
+   Native state keeping the parsed worklet of a function
+   */
+  struct JsiWorkletState : public jsi::NativeState {
+    explicit JsiWorkletState(std::shared_ptr<JsiWorklet> worklet)
+        : worklet(worklet) {}
+    std::shared_ptr<JsiWorklet> worklet;
+  };
+
 public:
   JsiWorklet(jsi::Runtime &runtime, const jsi::Value &arg) {
     createWorklet(runtime, arg);
   }
 
   JsiWorklet(jsi::Runtime &runtime, std::shared_ptr<jsi::Function> func) {
+    createWorklet(runtime, *func);
+  }
+
+  JsiWorklet(jsi::Runtime &runtime, const jsi::Function &func) {
     createWorklet(runtime, func);
   }
 
@@ -107,6 +106,12 @@ public:
     return defaultName;
   }
 
+  /**
+   Returns the wrapped closure of the worklet, or nullptr if the function is
+   not a worklet
+   */
+  std::shared_ptr<JsiWrapper> getClosureWrapper() { return _closureWrapper; }
+
   /**
    Returns the source location for the worklet
    */
@@ -129,9 +134,7 @@ public:
       return false;
     }
 
-    return isDecoratedAsWorklet(
-        runtime, std::make_shared<jsi::Function>(
-                     value.asObject(runtime).asFunction(runtime)));
+    return fromFunction(runtime, obj.asFunction(runtime))->isWorklet();
   }
 
   /**
@@ -141,39 +144,62 @@ public:
    */
   static bool isDecoratedAsWorklet(jsi::Runtime &runtime,
                                    std::shared_ptr<jsi::Function> func) {
-    auto hashProp = func->getProperty(runtime, PropNameWorkletHash);
-    if (hashProp.isString()) {
-      return true;
-    }
-
-    // Try to get the closure
-    jsi::Value closure = func->getProperty(runtime, PropNameWorkletClosure);
+    return fromFunction(runtime, *func)->isWorklet();
+  }
 
-    // Return if this is not a worklet
-    if (closure.isUndefined() || closure.isNull()) {
-      return false;
+  /**
+   Returns the worklet for a function. The function is parsed the first time
+   it is passed, and the worklet is kept in its native state, so passing the
+   same function object again does not read its properties. Functions that
+   are not worklets are remembered as well.
+   @runtime Runtime
+   @func Function to get the worklet for
+   */
+  static std::shared_ptr<JsiWorklet> fromFunction(jsi::Runtime &runtime,
+                                                  const jsi::Function &func) {
+    if (func.hasNativeState<JsiWorkletState>(runtime)) {
+      return func.getNativeState<JsiWorkletState>(runtime)->worklet;
     }
-
-    // Try to get the code
-    auto initData = func->getProperty(runtime, PropNameWorkletInitData);
-    if (!initData.isObject()) {
-      // Try old way of getting code
-      auto asString = func->getProperty(runtime, PropNameWorkletAsString);
-      if (!asString.isString()) {
-        return false;
-      }
+    parsedCount()++;
+    auto worklet = std::make_shared<JsiWorklet>(runtime, func);
+    // Leave native state set by others alone
+    if (!func.hasNativeState(runtime)) {
+      func.setNativeState(runtime, std::make_shared<JsiWorkletState>(worklet));
     }
+    return worklet;
+  }
+
+  /**
+   Returns the number of functions parsed by fromFunction
+   */
+  static size_t getParsedCount() { return parsedCount().load(); }
 
-    return true;
+  /**
+   Returns the worklet for a function value, see fromFunction
+   @runtime Runtime
+   @arg Function to get the worklet for
+   */
+  static std::shared_ptr<JsiWorklet> fromFunction(jsi::Runtime &runtime,
+                                                  const jsi::Value &arg) {
+    if (!arg.isObject() || !arg.asObject(runtime).isFunction(runtime)) {
+      throw jsi::JSError(runtime,
+                         "Worklets must be initialized from a valid function.");
+    }
+    return fromFunction(runtime, arg.asObject(runtime).asFunction(runtime));
   }
 
   /**
    Creates a jsi::Function in the provided runtime for the worklet. This
-   function can then be used to execute the worklet
+   function can then be used to execute the worklet. Worklets that read their
+   closure from jsThis are compiled inside a factory that receives jsThis, see
+   getBoundFunction.
    */
   std::shared_ptr<jsi::Function>
   createWorkletJsFunction(jsi::Runtime &runtime) {
-    auto evaluatedFunction = evaluteJavascriptInWorkletRuntime(runtime, _code);
+    auto evaluatedFunction = evaluteJavascriptInWorkletRuntime(
+        runtime, _isRea30Compat ? "(" + _code + "\n)"
+                                : "(function (" + std::string(PropNameJsThis) +
+                                      ") {\nreturn (" + _code + "\n);\n})");
 
     if (!evaluatedFunction.isObject()) {
       throw jsi::JSError(
@@ -191,6 +217,17 @@ public:
         evaluatedFunction.asObject(runtime).asFunction(runtime));
   }
 
+  /**
+   Returns the jsi::Function for the worklet in the provided runtime. Worklets
+   with the same hash and code share one function per runtime, so the code is
+   only evaluated the first time.
+   */
+  std::shared_ptr<jsi::Function> getWorkletJsFunction(jsi::Runtime &runtime) {
+    return JsiWorkletFunctionCache::getInstance().getOrCreate(
+        runtime, _workletHash, _code,
+        [&]() { return createWorkletJsFunction(runtime); });
+  }
+
   /**
    Calls the Worklet function with the given arguments.
    */
@@ -198,10 +235,10 @@ public:
                   jsi::Runtime &runtime, const jsi::Value &thisValue,
                   const jsi::Value *arguments, size_t count) {
 
-    // Unwrap closure
-    auto unwrappedClosure = JsiWrapper::unwrap(runtime, _closureWrapper);
-
     if (_isRea30Compat) {
+      // Unwrap closure
+      auto unwrappedClosure =
+          jsi::Value(runtime, getUnwrappedClosure(runtime));
 
       // Resolve this Value
       std::unique_ptr<jsi::Object> resolvedThisValue;
@@ -219,17 +256,14 @@ public:
       return workletFunction->callWithThis(runtime, *resolvedThisValue,
                                            arguments, count);
     } else {
-      // Prepare jsThis
-      jsi::Object jsThis(runtime);
-      jsThis.setProperty(runtime, PropNameWorkletClosure, unwrappedClosure);
-      JsThisWrapper thisWrapper(runtime, jsThis);
+      auto boundFunction = getBoundFunction(runtime, workletFunction);
 
       // Call the unwrapped function
       if (thisValue.isObject()) {
-        return workletFunction->callWithThis(
+        return boundFunction->callWithThis(
             runtime, thisValue.asObject(runtime), arguments, count);
       } else {
-        return workletFunction->call(runtime, arguments, count);
+        return boundFunction->call(runtime, arguments, count);
       }
     }
   }
@@ -240,6 +274,54 @@ public:
   static bool isWhitespace(unsigned char c) { return std::isspace(c); }
 
 private:
+  /**
+   Returns the closure unwrapped in the provided runtime. The closure of a
+   worklet never changes, so it is unwrapped once per runtime and reused by
+   later calls. Captured shared values are host objects and stay live, other
+   captured values are copied once.
+   */
+  const jsi::Value &getUnwrappedClosure(jsi::Runtime &runtime) {
+    std::shared_ptr<jsi::Value> closure;
+    {
+      std::lock_guard<std::mutex> lock(_unwrappedClosureMutex);
+      closure = _unwrappedClosure.get(runtime);
+    }
+    if (closure == nullptr) {
+      closure = std::make_shared<jsi::Value>(
+          JsiWrapper::unwrap(runtime, _closureWrapper));
+      std::lock_guard<std::mutex> lock(_unwrappedClosureMutex);
+      _unwrappedClosure.get(runtime) = closure;
+    }
+    return *closure;
+  }
+
+  /**
+   Returns the worklet function bound to a jsThis object holding the closure
+   in the provided runtime. The factory is called once per runtime, later
+   calls use the bound function directly.
+   @param runtime Runtime to call the worklet in
+   @param factory Factory created by createWorkletJsFunction
+   */
+  std::shared_ptr<jsi::Function>
+  getBoundFunction(jsi::Runtime &runtime,
+                   const std::shared_ptr<jsi::Function> &factory) {
+    {
+      std::lock_guard<std::mutex> lock(_unwrappedClosureMutex);
+      auto &bound = _boundFunction.get(runtime);
+      if (bound.first == factory.get()) {
+        return bound.second;
+      }
+    }
+    jsi::Object jsThis(runtime);
+    jsThis.setProperty(runtime, PropNameWorkletClosure,
+                       getUnwrappedClosure(runtime));
+    auto function = std::make_shared<jsi::Function>(
+        factory->call(runtime, jsThis).asObject(runtime).asFunction(runtime));
+    std::lock_guard<std::mutex> lock(_unwrappedClosureMutex);
+    _boundFunction.get(runtime) = {factory.get(), function};
+    return function;
+  }
+
   /**
    Installs the worklet function into the worklet runtime
   */
@@ -250,21 +332,19 @@ private:
                          "Worklets must be initialized from a valid function.");
     }
 
-    createWorklet(runtime, std::make_shared<jsi::Function>(
-                               arg.asObject(runtime).asFunction(runtime)));
+    createWorklet(runtime, arg.asObject(runtime).asFunction(runtime));
   }
 
   /**
    Installs the worklet function into the worklet runtime
    */
-  void createWorklet(jsi::Runtime &runtime,
-                     std::shared_ptr<jsi::Function> func) {
+  void createWorklet(jsi::Runtime &runtime, const jsi::Function &func) {
 
     // This is a worklet
     _isWorklet = false;
 
     // Try to get the closure
-    jsi::Value closure = func->getProperty(runtime, PropNameWorkletClosure);
+    jsi::Value closure = func.getProperty(runtime, PropNameWorkletClosure);
 
     // Return if this is not a worklet
     if (closure.isUndefined() || closure.isNull()) {
@@ -273,7 +353,7 @@ private:
 
     // Try to get the asString function
     jsi::Value initDataProp =
-        func->getProperty(runtime, PropNameWorkletInitData);
+        func.getProperty(runtime, PropNameWorkletInitData);
 
     if (initDataProp.isObject()) {
       // Get location
@@ -300,10 +380,12 @@ private:
 
     } else {
       // try old way
-      _code = func->getProperty(runtime, PropNameWorkletAsString)
-                  .asString(runtime)
-                  .utf8(runtime);
-      _location = func->getProperty(runtime, PropNameWorkletLocation)
+      auto asStringProp = func.getProperty(runtime, PropNameWorkletAsString);
+      if (!asStringProp.isString()) {
+        return;
+      }
+      _code = asStringProp.asString(runtime).utf8(runtime);
+      _location = func.getProperty(runtime, PropNameWorkletLocation)
                       .asString(runtime)
                       .utf8(runtime);
     }
@@ -330,21 +412,39 @@ private:
     _closureWrapper = JsiWrapper::wrap(runtime, closure);
 
     // Try get the name of the function
-    auto nameProp = func->getProperty(runtime, PropFunctionName);
+    auto nameProp = func.getProperty(runtime, PropFunctionName);
     if (nameProp.isString()) {
       _name = nameProp.asString(runtime).utf8(runtime);
     }
+
+    // Worklets without a hash from the babel plugin are keyed by their code
+    auto hashProp = func.getProperty(runtime, PropNameWorkletHash);
+    if (hashProp.isNumber()) {
+      _workletHash = hashProp.asNumber();
+    } else {
+      _workletHash = static_cast<double>(std::hash<std::string>()(_code));
+    }
   }
 
   jsi::Value evaluteJavascriptInWorkletRuntime(jsi::Runtime &runtime,
-                                               const std::string &code) {
-    auto codeBuffer =
-        std::make_shared<const jsi::StringBuffer>("(" + code + "\n)");
-    return runtime.evaluateJavaScript(codeBuffer, _location);
+                                               const std::string &source) {
+    return JsiPreparedScriptCache::getInstance().evaluate(runtime, _workletHash,
+                                                         source, _location);
+  }
+
+  static std::atomic<size_t> &parsedCount() {
+    static std::atomic<size_t> count = {0};
+    return count;
   }
 
   bool _isWorklet = false;
   std::shared_ptr<JsiWrapper> _closureWrapper;
+  // Only the entry of a runtime is used on its thread, the map is shared
+  std::mutex _unwrappedClosureMutex;
+  RuntimeAwareCache<std::shared_ptr<jsi::Value>> _unwrappedClosure;
+  // Factory the function was bound by, and the bound function
+  RuntimeAwareCache<std::pair<jsi::Function *, std::shared_ptr<jsi::Function>>>
+      _boundFunction;
   std::string _location = "";
   std::string _code = "";
   std::string _name = "fn";
@@ -358,18 +458,24 @@ public:
   explicit WorkletInvoker(std::shared_ptr<JsiWorklet> worklet)
       : _worklet(worklet) {}
   WorkletInvoker(jsi::Runtime &runtime, const jsi::Value &value)
-      : WorkletInvoker(std::make_shared<JsiWorklet>(runtime, value)) {}
+      : WorkletInvoker(JsiWorklet::fromFunction(runtime, value)) {}
 
   jsi::Value call(jsi::Runtime &runtime, const jsi::Value &thisValue,
                   const jsi::Value *arguments, size_t count) {
     if (_workletFunction.get(runtime) == nullptr) {
-      _workletFunction.get(runtime) =
-          _worklet->createWorkletJsFunction(runtime);
+      _workletFunction.get(runtime) = _worklet->getWorkletJsFunction(runtime);
     }
     return _worklet->call(_workletFunction.get(runtime), runtime, thisValue,
                           arguments, count);
   }
 
+  /**
+   Returns the wrapped closure of the worklet
+   */
+  std::shared_ptr<JsiWrapper> getClosureWrapper() {
+    return _worklet->getClosureWrapper();
+  }
+
 private:
   RuntimeAwareCache<std::shared_ptr<jsi::Function>> _workletFunction;
   std::shared_ptr<JsiWorklet> _worklet;
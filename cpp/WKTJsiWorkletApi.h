@@ -2,16 +2,21 @@
 
 #include <jsi/jsi.h>
 
+#include <algorithm>
 #include <atomic>
 #include <memory>
 #include <string>
 #include <thread>
 #include <vector>
 
+#include "WKTJsiChannel.h"
+#include "WKTJsiDerivedValue.h"
 #include "WKTJsiHostObject.h"
 #include "WKTJsiJsDecorator.h"
+#include "WKTJsiPreparedScriptCache.h"
 #include "WKTJsiPromiseWrapper.h"
 #include "WKTJsiSharedValue.h"
+#include "WKTJsiTripleBuffer.h"
 #include "WKTJsiWorklet.h"
 #include "WKTJsiWorkletContext.h"
 #include "WKTJsiWrapper.h"
@@ -58,11 +63,88 @@ public:
   };
 
   JSI_HOST_FUNCTION(createSharedValue) {
+    auto useLazyWrapping = false;
+    auto preserveReferences = false;
+    if (count > 1 && arguments[1].isObject()) {
+      auto options = arguments[1].asObject(runtime);
+      auto lazy = options.getProperty(runtime, "lazy");
+      useLazyWrapping = lazy.isBool() && lazy.getBool();
+      auto preserve = options.getProperty(runtime, "preserveReferences");
+      preserveReferences = preserve.isBool() && preserve.getBool();
+    }
     return jsi::Object::createFromHostObject(
         *JsiWorkletContext::getDefaultInstance()->getJsRuntime(),
-        std::make_shared<JsiSharedValue>(arguments[0]));
+        std::make_shared<JsiSharedValue>(arguments[0], useLazyWrapping,
+                                         preserveReferences));
   };
 
+  JSI_HOST_FUNCTION(createChannel) {
+    double capacity = 64;
+    if (count > 0 && arguments[0].isObject()) {
+      auto capacityProp =
+          arguments[0].asObject(runtime).getProperty(runtime, "capacity");
+      if (!capacityProp.isUndefined()) {
+        // Written so that NaN fails the range check
+        if (!capacityProp.isNumber() || !(capacityProp.asNumber() >= 1) ||
+            !(capacityProp.asNumber() <=
+              static_cast<double>(JsiChannel::MaxCapacity))) {
+          throw jsi::JSError(runtime,
+                             "createChannel expects a capacity between 1 and " +
+                                 std::to_string(JsiChannel::MaxCapacity) + ".");
+        }
+        capacity = capacityProp.asNumber();
+      }
+    }
+    return jsi::Object::createFromHostObject(
+        runtime, std::make_shared<JsiChannel>(static_cast<size_t>(capacity)));
+  }
+
+  JSI_HOST_FUNCTION(createTripleBuffer) {
+    jsi::Value undefined;
+    return jsi::Object::createFromHostObject(
+        runtime, std::make_shared<JsiTripleBuffer>(
+                     runtime, count > 0 ? arguments[0] : undefined));
+  }
+
+  JSI_HOST_FUNCTION(createDerivedValue) {
+    if (count < 2 || !JsiWorklet::isDecoratedAsWorklet(runtime, arguments[0]) ||
+        !arguments[1].isObject() ||
+        !arguments[1].asObject(runtime).isArray(runtime)) {
+      throw jsi::JSError(runtime,
+                         "createDerivedValue expects a worklet and an array of "
+                         "shared values as its parameters.");
+    }
+
+    auto deps = arguments[1].asObject(runtime).asArray(runtime);
+    size_t size = deps.size(runtime);
+    std::vector<std::shared_ptr<JsiSharedValue>> dependencies;
+    dependencies.reserve(size);
+    for (size_t i = 0; i < size; i++) {
+      auto dep = deps.getValueAtIndex(runtime, i);
+      if (!dep.isObject() ||
+          !dep.asObject(runtime).isHostObject<JsiSharedValue>(runtime)) {
+        throw jsi::JSError(runtime, "createDerivedValue expects an array of "
+                                    "shared values as its dependencies.");
+      }
+      dependencies.push_back(
+          dep.asObject(runtime).getHostObject<JsiSharedValue>(runtime));
+    }
+
+    std::shared_ptr<JsiWorkletContext> context;
+    if (count > 2 && arguments[2].isObject()) {
+      auto contextObj = arguments[2].asObject(runtime);
+      if (!contextObj.isHostObject<JsiWorkletContext>(runtime)) {
+        throw jsi::JSError(runtime, "createDerivedValue expects a worklet "
+                                    "context as its third parameter.");
+      }
+      context = contextObj.getHostObject<JsiWorkletContext>(runtime);
+    }
+
+    return jsi::Object::createFromHostObject(
+        runtime, std::make_shared<JsiDerivedValue>(runtime, arguments[0],
+                                                   dependencies, context));
+  }
+
   JSI_HOST_FUNCTION(createRunOnJS) {
     if (count != 1) {
       throw jsi::JSError(runtime, "createRunOnJS expects one parameter.");
@@ -119,6 +201,122 @@ public:
     return jsi::Value(thisThreadId);
   }
 
+  JSI_HOST_FUNCTION(getMemoryStats) {
+    // Memory reachable from several roots is counted for the first one
+    JsiMemoryCounter counter;
+
+    auto sharedValueCount = JsiSharedValue::getAllMemoryStats(counter);
+    auto sharedValues = counter.getStats().toObject(runtime);
+    sharedValues.setProperty(runtime, "count",
+                             static_cast<double>(sharedValueCount));
+
+    auto contexts = JsiWorkletContext::getContexts();
+    auto contextStats = jsi::Array(runtime, contexts.size());
+    for (size_t i = 0; i < contexts.size(); i++) {
+      auto stats = contexts[i]->getMemoryStats(counter);
+      jsi::Object context(runtime);
+      context.setProperty(runtime, "name", jsi::String::createFromUtf8(
+                                               runtime, contexts[i]->getName()));
+      context.setProperty(runtime, "queuedArguments",
+                          stats.queuedArguments.toObject(runtime));
+      context.setProperty(runtime, "closures",
+                          stats.closures.toObject(runtime));
+      contextStats.setValueAtIndex(runtime, i, context);
+    }
+
+    auto result = counter.getStats().toObject(runtime);
+    result.setProperty(runtime, "sharedValues", sharedValues);
+    result.setProperty(runtime, "contexts", contextStats);
+    return result;
+  }
+
+  JSI_HOST_FUNCTION(setMemoryStatsEnabled) {
+    if (count == 0 || !arguments[0].isBool()) {
+      throw jsi::JSError(runtime, "setMemoryStatsEnabled expects a boolean as "
+                                  "its parameter.");
+    }
+    JsiWorkletContext::setMemoryTrackingEnabled(arguments[0].getBool());
+    return jsi::Value::undefined();
+  }
+
+  JSI_HOST_FUNCTION(getWorkletCacheStats) {
+    auto result =
+        JsiWorkletFunctionCache::getInstance().getStats().toObject(runtime);
+    result.setProperty(
+        runtime, "prepared",
+        JsiPreparedScriptCache::getInstance().getStats().toObject(runtime));
+    result.setProperty(
+        runtime, "disk",
+        JsiBytecodeDiskCache::getInstance().getStats().toObject(runtime));
+    result.setProperty(runtime, "parsed",
+                       static_cast<double>(JsiWorklet::getParsedCount()));
+    return result;
+  }
+
+  JSI_HOST_FUNCTION(setBytecodeCacheDirectory) {
+    if (count == 0 || !(arguments[0].isString() || arguments[0].isNull())) {
+      throw jsi::JSError(runtime, "setBytecodeCacheDirectory expects a path "
+                                  "or null as its parameter.");
+    }
+#if WKT_BYTECODE_DISK_CACHE
+    JsiBytecodeDiskCache::getInstance().setDirectory(
+        arguments[0].isString() ? arguments[0].asString(runtime).utf8(runtime)
+                                : "");
+#else
+    // Without the Hermes compiler there is no bytecode to store
+    if (arguments[0].isString()) {
+      throw jsi::JSError(runtime,
+                         "setBytecodeCacheDirectory is not supported, it "
+                         "requires Hermes built with its compiler.");
+    }
+#endif
+    return jsi::Value::undefined();
+  }
+
+  JSI_HOST_FUNCTION(batch) {
+    if (count != 2 || !arguments[0].isObject() ||
+        !arguments[0].asObject(runtime).isArray(runtime) ||
+        !arguments[1].isObject() ||
+        !arguments[1].asObject(runtime).isFunction(runtime)) {
+      throw jsi::JSError(runtime, "batch expects an array of shared values "
+                                  "and a function as its parameters.");
+    }
+
+    auto values = arguments[0].asObject(runtime).asArray(runtime);
+    size_t size = values.size(runtime);
+    std::vector<std::shared_ptr<JsiSharedValue>> sharedValues;
+    sharedValues.reserve(size);
+    for (size_t i = 0; i < size; i++) {
+      auto value = values.getValueAtIndex(runtime, i);
+      if (!value.isObject() ||
+          !value.asObject(runtime).isHostObject<JsiSharedValue>(runtime)) {
+        throw jsi::JSError(runtime,
+                           "batch expects an array of shared values.");
+      }
+      sharedValues.push_back(
+          value.asObject(runtime).getHostObject<JsiSharedValue>(runtime));
+    }
+
+    // Values are always locked in the same order so that concurrent batches
+    // on overlapping values can't deadlock
+    std::sort(sharedValues.begin(), sharedValues.end());
+    sharedValues.erase(std::unique(sharedValues.begin(), sharedValues.end()),
+                       sharedValues.end());
+
+    std::vector<std::unique_ptr<JsiWrapper::BatchScope>> scopes;
+    scopes.reserve(sharedValues.size());
+    for (auto &sharedValue : sharedValues) {
+      scopes.push_back(sharedValue->beginTransaction());
+    }
+    auto result =
+        arguments[1].asObject(runtime).asFunction(runtime).call(runtime);
+    // All values are unlocked before the listeners of any of them are called
+    for (auto &scope : scopes) {
+      scope->unlock();
+    }
+    return result;
+  }
+
   JSI_HOST_FUNCTION(__jsi_is_array) {
     if (count == 0) {
       throw jsi::JSError(runtime, "__getTypeIsArray expects one parameter.");
@@ -148,6 +346,9 @@ public:
 
   JSI_EXPORT_FUNCTIONS(JSI_EXPORT_FUNC(JsiWorkletApi, createSharedValue),
                        JSI_EXPORT_FUNC(JsiWorkletApi, createContext),
+                       JSI_EXPORT_FUNC(JsiWorkletApi, createChannel),
+                       JSI_EXPORT_FUNC(JsiWorkletApi, createTripleBuffer),
+                       JSI_EXPORT_FUNC(JsiWorkletApi, createDerivedValue),
                        JSI_EXPORT_FUNC(JsiWorkletApi, createRunOnJS),
                        JSI_EXPORT_FUNC(JsiWorkletApi, runOnJS),
                        JSI_EXPORT_FUNC(JsiWorkletApi,
@@ -155,6 +356,12 @@ public:
                        JSI_EXPORT_FUNC(JsiWorkletApi,
                                        createRunInJsFn), // <-- deprecated
                        JSI_EXPORT_FUNC(JsiWorkletApi, getCurrentThreadId),
+                       JSI_EXPORT_FUNC(JsiWorkletApi, getMemoryStats),
+                       JSI_EXPORT_FUNC(JsiWorkletApi, setMemoryStatsEnabled),
+                       JSI_EXPORT_FUNC(JsiWorkletApi, batch),
+                       JSI_EXPORT_FUNC(JsiWorkletApi, getWorkletCacheStats),
+                       JSI_EXPORT_FUNC(JsiWorkletApi,
+                                       setBytecodeCacheDirectory),
                        JSI_EXPORT_FUNC(JsiWorkletApi, __jsi_is_array),
                        JSI_EXPORT_FUNC(JsiWorkletApi, __jsi_is_object))
 
@@ -14,6 +14,7 @@
 #include "WKTJsiPerformanceDecorator.h"
 #include "WKTJsiSetImmediateDecorator.h"
 
+#include <algorithm>
 #include <exception>
 #include <functional>
 #include <memory>
@@ -35,6 +36,8 @@ const char *GlobalPropertyName = "global";
 
 std::shared_ptr<JsiWorkletContext> JsiWorkletContext::defaultInstance;
 std::map<void *, JsiWorkletContext *> JsiWorkletContext::runtimeMappings;
+std::mutex JsiWorkletContext::runtimeMappingsMutex;
+std::atomic<bool> JsiWorkletContext::memoryTrackingEnabled = {false};
 size_t JsiWorkletContext::contextIdNumber = 1000;
 
 namespace jsi = facebook::jsi;
@@ -64,7 +67,8 @@ JsiWorkletContext::JsiWorkletContext(
 
 JsiWorkletContext::~JsiWorkletContext() {
   // Remove from thread contexts
-  runtimeMappings.erase(&_workletRuntime);
+  std::lock_guard<std::mutex> lock(runtimeMappingsMutex);
+  runtimeMappings.erase(_workletRuntime.get());
 }
 
 void JsiWorkletContext::initialize(
@@ -79,7 +83,11 @@ void JsiWorkletContext::initialize(
   _contextId = ++contextIdNumber;
 
   _jsThreadId = std::this_thread::get_id();
-  runtimeMappings.emplace(&getWorkletRuntime(), this);
+  auto &workletRuntime = getWorkletRuntime();
+  {
+    std::lock_guard<std::mutex> lock(runtimeMappingsMutex);
+    runtimeMappings.emplace(&workletRuntime, this);
+  }
 
   // Add default decorators
   addDecorator(std::make_shared<JsiSetImmediateDecorator>());
@@ -178,6 +186,71 @@ void JsiWorkletContext::addDecorator(
   cond.wait(lock, [&]() { return isFinished; });
 }
 
+/**
+ Adds a weak reference to the list, dropping released wrappers whenever the
+ list is about to grow
+ */
+static void trackWrapper(std::vector<std::weak_ptr<JsiWrapper>> &list,
+                         std::shared_ptr<JsiWrapper> wrapper) {
+  if (list.size() == list.capacity()) {
+    list.erase(std::remove_if(list.begin(), list.end(),
+                              [](const std::weak_ptr<JsiWrapper> &item) {
+                                return item.expired();
+                              }),
+               list.end());
+  }
+  list.push_back(wrapper);
+}
+
+void JsiWorkletContext::trackArguments(
+    const std::vector<std::shared_ptr<JsiWrapper>> &wrappers,
+    std::shared_ptr<JsiWrapper> thisWrapper) {
+  if (!isMemoryTrackingEnabled()) {
+    return;
+  }
+  std::lock_guard<std::mutex> lock(_trackedMutex);
+  for (auto &wrapper : wrappers) {
+    trackWrapper(_trackedArguments, wrapper);
+  }
+  if (thisWrapper != nullptr &&
+      thisWrapper->getType() != JsiWrapperType::Undefined) {
+    trackWrapper(_trackedArguments, thisWrapper);
+  }
+}
+
+void JsiWorkletContext::trackClosure(std::shared_ptr<JsiWrapper> closure) {
+  if (closure == nullptr || !isMemoryTrackingEnabled()) {
+    return;
+  }
+  std::lock_guard<std::mutex> lock(_trackedMutex);
+  trackWrapper(_trackedClosures, closure);
+}
+
+JsiWorkletContext::MemoryStats
+JsiWorkletContext::getMemoryStats(JsiMemoryCounter &counter) {
+  std::lock_guard<std::mutex> lock(_trackedMutex);
+  MemoryStats stats;
+
+  auto before = counter.getStats();
+  for (auto &item : _trackedArguments) {
+    auto wrapper = item.lock();
+    if (wrapper != nullptr) {
+      wrapper->getMemoryStats(counter);
+    }
+  }
+  stats.queuedArguments = counter.getStats() - before;
+
+  before = counter.getStats();
+  for (auto &item : _trackedClosures) {
+    auto wrapper = item.lock();
+    if (wrapper != nullptr) {
+      wrapper->getMemoryStats(counter);
+    }
+  }
+  stats.closures = counter.getStats() - before;
+  return stats;
+}
+
 jsi::HostFunctionType
 JsiWorkletContext::createCallInContext(jsi::Runtime &runtime,
                                        const jsi::Value &maybeFunc) {
@@ -187,7 +260,9 @@ JsiWorkletContext::createCallInContext(jsi::Runtime &runtime,
 jsi::HostFunctionType
 JsiWorkletContext::createCallInContext(jsi::Runtime &runtime,
                                        const jsi::Value &maybeFunc,
-                                       JsiWorkletContext *ctx) {
+                                       JsiWorkletContext *ctx,
+                                       bool lazyArguments,
+                                       bool preserveArgumentReferences) {
 
   // Ensure that we are passing a function as the param.
   if (!maybeFunc.isObject() ||
@@ -204,24 +279,34 @@ JsiWorkletContext::createCallInContext(jsi::Runtime &runtime,
   // Create a worklet of the function if the function is a worklet - it should
   // be allowed to create a caller function and call inside the same JS or ctx
   // without having to pass a worklet
-  auto workletInvoker =
-      JsiWorklet::isDecoratedAsWorklet(runtime, func)
-          ? std::make_shared<WorkletInvoker>(runtime, maybeFunc)
-          : nullptr;
+  auto worklet = JsiWorklet::fromFunction(runtime, *func);
+  auto workletInvoker = worklet->isWorklet()
+                            ? std::make_shared<WorkletInvoker>(worklet)
+                            : nullptr;
+
+  // Calls into JS are accounted to the default context
+  auto trackingCtx = ctx != nullptr ? ctx : getDefaultInstance();
+  if (workletInvoker != nullptr) {
+    trackingCtx->trackClosure(workletInvoker->getClosureWrapper());
+  }
 
   // Now return the caller function as a hostfunction type.
-  return [workletInvoker, func,
-          ctx](jsi::Runtime &runtime, const jsi::Value &thisValue,
-               const jsi::Value *arguments, size_t count) -> jsi::Value {
+  return [workletInvoker, func, ctx, trackingCtx, lazyArguments,
+          preserveArgumentReferences](
+             jsi::Runtime &runtime, const jsi::Value &thisValue,
+             const jsi::Value *arguments, size_t count) -> jsi::Value {
     auto callingCtx = getCurrent(runtime);
     auto convention = getCallingConvention(callingCtx, ctx);
 
     // Start by wrapping the arguments
-    ArgumentsWrapper argsWrapper(runtime, arguments, count);
+    ArgumentsWrapper argsWrapper(runtime, arguments, count, lazyArguments,
+                                 preserveArgumentReferences);
 
     // Wrap the this value
     auto thisWrapper = JsiWrapper::wrap(runtime, thisValue);
 
+    trackingCtx->trackArguments(argsWrapper.getWrappers(), thisWrapper);
+
     // If we are calling directly from/to the JS context or within the same
     // context, we can just dispatch everything directly.
     if (convention == CallingConvention::JsToJs ||
@@ -430,6 +515,8 @@ JsiWorkletContext::createInvoker(jsi::Runtime &runtime,
     // We're about to cross contexts and will need to wrap args
     auto thisWrapper = JsiWrapper::wrap(runtime, thisValue);
     ArgumentsWrapper argsWrapper(runtime, arguments, count);
+    (ctx != nullptr ? ctx : getDefaultInstance())
+        ->trackArguments(argsWrapper.getWrappers());
 
     if (ctx != nullptr) {
       // We are on a worklet thread
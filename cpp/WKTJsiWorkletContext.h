@@ -5,11 +5,14 @@
 #include "WKTJsiBaseDecorator.h"
 #include "WKTJsiHostObject.h"
 #include "WKTJsiJsDecorator.h"
+#include "WKTJsiMemoryStats.h"
 
+#include <atomic>
 #include <exception>
 #include <functional>
 #include <map>
 #include <memory>
+#include <mutex>
 #include <string>
 #include <vector>
 
@@ -19,6 +22,8 @@ namespace RNWorklet {
 
 namespace jsi = facebook::jsi;
 
+class JsiWrapper;
+
 class JsiWorkletContext
     : public JsiHostObject,
       public std::enable_shared_from_this<JsiWorkletContext> {
@@ -115,11 +120,27 @@ public:
    JS thread (or any other invalid context thread) nullptr is returned.
    */
   static JsiWorkletContext *getCurrent(jsi::Runtime &runtime) {
-    auto rtPtr = static_cast<void *>(&runtime);
-    if (runtimeMappings.count(rtPtr) != 0) {
-      return runtimeMappings.at(rtPtr);
+    std::lock_guard<std::mutex> lock(runtimeMappingsMutex);
+    auto it = runtimeMappings.find(static_cast<void *>(&runtime));
+    return it != runtimeMappings.end() ? it->second : nullptr;
+  }
+
+  /**
+   Returns all initialized contexts, including the default context. The
+   contexts are kept alive by the returned pointers, contexts that are being
+   destroyed are left out.
+   */
+  static std::vector<std::shared_ptr<JsiWorkletContext>> getContexts() {
+    std::lock_guard<std::mutex> lock(runtimeMappingsMutex);
+    std::vector<std::shared_ptr<JsiWorkletContext>> contexts;
+    contexts.reserve(runtimeMappings.size());
+    for (auto &mapping : runtimeMappings) {
+      auto context = mapping.second->weak_from_this().lock();
+      if (context != nullptr) {
+        contexts.push_back(std::move(context));
+      }
     }
-    return nullptr;
+    return contexts;
   }
 
   size_t getContextId() { return _contextId; }
@@ -158,12 +179,24 @@ public:
   }
 
   JSI_HOST_FUNCTION(createRunAsync) {
-    if (count != 1) {
-      throw jsi::JSError(runtime, "createRunAsync expects one parameter.");
+    if (count != 1 && count != 2) {
+      throw jsi::JSError(runtime, "createRunAsync expects a worklet and an "
+                                  "optional options parameter.");
+    }
+
+    auto lazyArguments = false;
+    auto preserveArgumentReferences = false;
+    if (count == 2 && arguments[1].isObject()) {
+      auto options = arguments[1].asObject(runtime);
+      auto lazy = options.getProperty(runtime, "lazyArguments");
+      lazyArguments = lazy.isBool() && lazy.getBool();
+      auto preserve =
+          options.getProperty(runtime, "preserveArgumentReferences");
+      preserveArgumentReferences = preserve.isBool() && preserve.getBool();
     }
 
-    auto caller =
-        JsiWorkletContext::createCallInContext(runtime, arguments[0], this);
+    auto caller = JsiWorkletContext::createCallInContext(
+        runtime, arguments[0], this, lazyArguments, preserveArgumentReferences);
 
     // Now let us create the caller function.
     return jsi::Function::createFromHostFunction(
@@ -223,12 +256,17 @@ public:
    @param maybeFunc Function to call - might be a worklet or might not - depends
    on wether we call cross context or not.
    @param ctx Context to call the function in
+   @param lazyArguments Wraps objects nested in the arguments when they are
+   first accessed
+   @param preserveArgumentReferences Wraps objects referenced from several
+   places in the arguments once
    @returns A host function type that will return a promise calling the
    maybeFunc.
    */
-  static jsi::HostFunctionType createCallInContext(jsi::Runtime &runtime,
-                                                   const jsi::Value &maybeFunc,
-                                                   JsiWorkletContext *ctx);
+  static jsi::HostFunctionType
+  createCallInContext(jsi::Runtime &runtime, const jsi::Value &maybeFunc,
+                      JsiWorkletContext *ctx, bool lazyArguments = false,
+                      bool preserveArgumentReferences = false);
 
   /**
    Calls a worklet function in a given context (or in the JS context if the ctx
@@ -259,6 +297,49 @@ public:
   static CallingConvention getCallingConvention(JsiWorkletContext *fromContext,
                                                 JsiWorkletContext *toContext);
 
+  /**
+   Memory used by the wrappers a context holds for pending calls and worklets
+   */
+  struct MemoryStats {
+    JsiMemoryStats queuedArguments;
+    JsiMemoryStats closures;
+  };
+
+  /**
+   Turns tracking of arguments and closures for memory stats on or off. It is
+   off by default so that calls don't pay for it. Only calls and worklets
+   created while it is on are counted.
+   */
+  static void setMemoryTrackingEnabled(bool enabled) {
+    memoryTrackingEnabled = enabled;
+  }
+
+  static bool isMemoryTrackingEnabled() {
+    return memoryTrackingEnabled.load(std::memory_order_relaxed);
+  }
+
+  /**
+   Tracks the wrapped arguments and this value of a call into the context for
+   memory stats. Wrappers are held weakly and drop out when the call has
+   released them. Does nothing unless memory tracking is enabled.
+   */
+  void trackArguments(const std::vector<std::shared_ptr<JsiWrapper>> &wrappers,
+                      std::shared_ptr<JsiWrapper> thisWrapper = nullptr);
+
+  /**
+   Tracks the wrapped closure of a worklet called in the context for memory
+   stats. The closure is held weakly. Does nothing unless memory tracking is
+   enabled.
+   */
+  void trackClosure(std::shared_ptr<JsiWrapper> closure);
+
+  /**
+   Adds the memory used by the tracked arguments and closures to the counter
+   @param counter Counter to add to
+   @return Memory added for arguments and closures
+   */
+  MemoryStats getMemoryStats(JsiMemoryCounter &counter);
+
   /**
    Verifies that the runtime is the correct runtime for the current context
    (worklet context or js context). NOTE: Only verifies in debug mode
@@ -286,8 +367,14 @@ private:
   size_t _contextId;
   std::thread::id _jsThreadId;
 
+  std::mutex _trackedMutex;
+  std::vector<std::weak_ptr<JsiWrapper>> _trackedArguments;
+  std::vector<std::weak_ptr<JsiWrapper>> _trackedClosures;
+
   static std::shared_ptr<JsiWorkletContext> defaultInstance;
   static std::map<void *, JsiWorkletContext *> runtimeMappings;
+  static std::mutex runtimeMappingsMutex;
+  static std::atomic<bool> memoryTrackingEnabled;
   static size_t contextIdNumber;
 };
 
@@ -0,0 +1,167 @@
+#pragma once
+
+#include <jsi/jsi.h>
+
+#include <functional>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+
+#include "WKTRuntimeLifecycleMonitor.h"
+
+namespace RNWorklet {
+
+namespace jsi = facebook::jsi;
+
+/**
+ Cache of evaluated worklet functions per runtime, keyed by the worklet hash
+ that the babel plugin adds to worklets. Worklets created again from the same
+ source, like a worklet passed on every call or recreated on every render,
+ reuse the function evaluated the first time instead of evaluating their code
+ again.
+
+ Each runtime keeps its most recently used functions. Entries are only evicted
+ and released on the thread of their runtime, when that runtime adds a new
+ function, or when the runtime is destroyed.
+ */
+class JsiWorkletFunctionCache : public RuntimeLifecycleListener {
+public:
+  static constexpr size_t DefaultCapacity = 256;
+
+  struct Stats {
+    size_t hits = 0;
+    size_t misses = 0;
+    size_t evictions = 0;
+    size_t size = 0;
+
+    jsi::Object toObject(jsi::Runtime &runtime) const {
+      jsi::Object result(runtime);
+      result.setProperty(runtime, "hits", static_cast<double>(hits));
+      result.setProperty(runtime, "misses", static_cast<double>(misses));
+      result.setProperty(runtime, "evictions", static_cast<double>(evictions));
+      result.setProperty(runtime, "size", static_cast<double>(size));
+      return result;
+    }
+  };
+
+  /**
+   Returns the cache. It is never destroyed, so that runtimes destroyed by
+   static destructors can still be removed from it.
+   */
+  static JsiWorkletFunctionCache &getInstance() {
+    static auto instance = new JsiWorkletFunctionCache();
+    return *instance;
+  }
+
+  /**
+   Returns the function for a worklet in the runtime, creating it on a miss
+   @param runtime Runtime to get the function for
+   @param hash Hash of the worklet
+   @param code Code of the worklet, compared on hits to rule out collisions
+   @param create Evaluates the worklet code in the runtime
+   */
+  std::shared_ptr<jsi::Function>
+  getOrCreate(jsi::Runtime &runtime, double hash, const std::string &code,
+              const std::function<std::shared_ptr<jsi::Function>()> &create) {
+    {
+      std::lock_guard<std::mutex> lock(_mutex);
+      auto &cache = getRuntimeCache(runtime);
+      auto it = cache.index.find(hash);
+      if (it != cache.index.end() && it->second->code == code) {
+        cache.entries.splice(cache.entries.begin(), cache.entries, it->second);
+        _stats.hits++;
+        return it->second->function;
+      }
+      _stats.misses++;
+    }
+
+    // Evaluate without holding the lock, evaluation can take a while
+    auto function = create();
+
+    // Evicted functions are released after the lock
+    std::list<Entry> evicted;
+    std::lock_guard<std::mutex> lock(_mutex);
+    auto &cache = getRuntimeCache(runtime);
+    auto it = cache.index.find(hash);
+    if (it != cache.index.end()) {
+      evicted.splice(evicted.end(), cache.entries, it->second);
+      cache.index.erase(it);
+      _stats.size--;
+    }
+    cache.entries.push_front({hash, code, function});
+    cache.index.emplace(hash, cache.entries.begin());
+    _stats.size++;
+    while (cache.entries.size() > _capacity) {
+      cache.index.erase(cache.entries.back().hash);
+      evicted.splice(evicted.end(), cache.entries,
+                     std::prev(cache.entries.end()));
+      _stats.size--;
+      _stats.evictions++;
+    }
+    return function;
+  }
+
+  /**
+   Returns the hit, miss and eviction counters and the number of cached
+   functions in all runtimes
+   */
+  Stats getStats() {
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _stats;
+  }
+
+  /**
+   Sets the number of functions kept per runtime. Runtimes over the capacity
+   evict when they add their next function.
+   */
+  void setCapacity(size_t capacity) {
+    std::lock_guard<std::mutex> lock(_mutex);
+    _capacity = capacity;
+  }
+
+  void onRuntimeDestroyed(jsi::Runtime *runtime) override {
+    RuntimeCache cache;
+    std::lock_guard<std::mutex> lock(_mutex);
+    auto it = _runtimeCaches.find(runtime);
+    if (it != _runtimeCaches.end()) {
+      _stats.size -= it->second.entries.size();
+      cache = std::move(it->second);
+      _runtimeCaches.erase(it);
+    }
+  }
+
+private:
+  struct Entry {
+    double hash;
+    std::string code;
+    std::shared_ptr<jsi::Function> function;
+  };
+
+  struct RuntimeCache {
+    // Most recently used first
+    std::list<Entry> entries;
+    std::unordered_map<double, std::list<Entry>::iterator> index;
+  };
+
+  /**
+   Returns the cache of a runtime. Caller must hold the lock.
+   */
+  RuntimeCache &getRuntimeCache(jsi::Runtime &runtime) {
+    auto it = _runtimeCaches.find(&runtime);
+    if (it == _runtimeCaches.end()) {
+      RuntimeLifecycleMonitor::addListener(runtime, this);
+      it = _runtimeCaches.emplace(&runtime, RuntimeCache()).first;
+    }
+    return it->second;
+  }
+
+  std::mutex _mutex;
+  size_t _capacity = DefaultCapacity;
+  Stats _stats;
+  std::unordered_map<jsi::Runtime *, RuntimeCache> _runtimeCaches;
+};
+
+} // namespace RNWorklet
@@ -0,0 +1,361 @@
+#pragma once
+
+#include <jsi/jsi.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+#include "WKTJsiHostObject.h"
+#include "WKTJsiPromiseWrapper.h"
+#include "WKTJsiWorkletContext.h"
+#include "WKTJsiWrapper.h"
+
+namespace RNWorklet {
+
+namespace jsi = facebook::jsi;
+
+/**
+ Bounded channel for streaming values between the JS thread and worklet
+ contexts. Values are copied into detached wrappers when sent and unwrapped in
+ the receiving runtime.
+
+ The buffer is a lock-free ring where every slot carries a sequence number, so
+ any number of senders and receivers can use it concurrently. Only receivers
+ waiting on an empty channel and senders waiting on a full one are parked in a
+ locked list. A parked receiver is woken on its own thread by the send that
+ follows, and a parked sender by the receive that follows.
+ */
+class JsiChannel : public JsiHostObject,
+                   public std::enable_shared_from_this<JsiChannel> {
+public:
+  /**
+   Largest capacity a channel can be created with, its slots are allocated
+   up front
+   */
+  static constexpr size_t MaxCapacity = 1 << 20;
+
+  /**
+   Constructs a channel
+   @param capacity Number of values the channel can hold
+   */
+  explicit JsiChannel(size_t capacity)
+      : _capacity(capacity), _slots(new Slot[capacity]) {
+    for (size_t i = 0; i < capacity; i++) {
+      _slots[i].sequence.store(i, std::memory_order_relaxed);
+    }
+  }
+
+  JSI_HOST_FUNCTION(trySend) {
+    return push(JsiWrapper::wrap(runtime, getArgument(arguments, count)));
+  }
+
+  JSI_HOST_FUNCTION(send) {
+    auto wrapper = JsiWrapper::wrap(runtime, getArgument(arguments, count));
+    return createPromise(runtime, [this, wrapper](
+                                      jsi::Runtime &runtime,
+                                      std::shared_ptr<PromiseParameter> promise) {
+      if (push(wrapper)) {
+        promise->resolve(runtime, jsi::Value::undefined());
+        return;
+      }
+      park(runtime, createWaiter(runtime, promise, wrapper));
+    });
+  }
+
+  JSI_HOST_FUNCTION(tryReceive) {
+    std::shared_ptr<JsiWrapper> wrapper;
+    if (!pop(wrapper)) {
+      return jsi::Value::undefined();
+    }
+    return wrapper->unwrap(runtime);
+  }
+
+  JSI_HOST_FUNCTION(receive) {
+    return createPromise(runtime, [this](
+                                      jsi::Runtime &runtime,
+                                      std::shared_ptr<PromiseParameter> promise) {
+      std::shared_ptr<JsiWrapper> wrapper;
+      if (pop(wrapper)) {
+        promise->resolve(runtime, wrapper->unwrap(runtime));
+        return;
+      }
+      park(runtime, createWaiter(runtime, promise, nullptr));
+    });
+  }
+
+  JSI_HOST_FUNCTION(drain) {
+    auto max = _capacity;
+    if (count > 0 && arguments[0].isNumber()) {
+      // Clamp as a double, Infinity and huge counts don't fit in size_t
+      auto requested = arguments[0].asNumber();
+      max = requested > 0 ? static_cast<size_t>(std::min(
+                                std::trunc(requested),
+                                static_cast<double>(_capacity)))
+                          : 0;
+    }
+    std::vector<std::shared_ptr<JsiWrapper>> wrappers;
+    std::shared_ptr<JsiWrapper> wrapper;
+    while (wrappers.size() < max && pop(wrapper)) {
+      wrappers.push_back(wrapper);
+    }
+    auto result = jsi::Array(runtime, wrappers.size());
+    for (size_t i = 0; i < wrappers.size(); i++) {
+      result.setValueAtIndex(runtime, i, wrappers[i]->unwrap(runtime));
+    }
+    return result;
+  }
+
+  JSI_PROPERTY_GET(capacity) { return static_cast<double>(_capacity); }
+
+  JSI_EXPORT_FUNCTIONS(JSI_EXPORT_FUNC(JsiChannel, trySend),
+                       JSI_EXPORT_FUNC(JsiChannel, send),
+                       JSI_EXPORT_FUNC(JsiChannel, tryReceive),
+                       JSI_EXPORT_FUNC(JsiChannel, receive),
+                       JSI_EXPORT_FUNC(JsiChannel, drain))
+
+  JSI_EXPORT_PROPERTY_GETTERS(JSI_EXPORT_PROP_GET(JsiChannel, capacity))
+
+private:
+  struct Slot {
+    std::atomic<size_t> sequence;
+    std::shared_ptr<JsiWrapper> value;
+  };
+
+  /**
+   A parked send or receive. Waiters are resumed on the thread of the runtime
+   they were created in.
+   */
+  struct Waiter {
+    std::weak_ptr<JsiWorkletContext> context;
+    bool isJsThread;
+    std::shared_ptr<PromiseParameter> promise;
+    // Value to send, nullptr for receivers
+    std::shared_ptr<JsiWrapper> value;
+  };
+
+  static const jsi::Value &getArgument(const jsi::Value *arguments,
+                                       size_t count) {
+    static const jsi::Value undefined;
+    return count > 0 ? arguments[0] : undefined;
+  }
+
+  jsi::Value createPromise(jsi::Runtime &runtime,
+                           PromiseComputationFunction computation) {
+    auto promise = JsiPromiseWrapper::createPromiseWrapper(runtime, computation);
+    return jsi::Object::createFromHostObject(runtime, promise);
+  }
+
+  std::shared_ptr<Waiter> createWaiter(jsi::Runtime &runtime,
+                                       std::shared_ptr<PromiseParameter> promise,
+                                       std::shared_ptr<JsiWrapper> value) {
+    auto ctx = JsiWorkletContext::getCurrent(runtime);
+    auto waiter = std::make_shared<Waiter>();
+    waiter->isJsThread = ctx == nullptr;
+    waiter->context = waiter->isJsThread
+                          ? JsiWorkletContext::getDefaultInstanceAsShared()
+                          : ctx->shared_from_this();
+    waiter->promise = promise;
+    waiter->value = value;
+    return waiter;
+  }
+
+  /**
+   Adds a value to the ring
+   @return False if the channel is full
+   */
+  bool push(const std::shared_ptr<JsiWrapper> &value) {
+    auto pos = _sendPos.load(std::memory_order_relaxed);
+    Slot *slot;
+    while (true) {
+      slot = &_slots[pos % _capacity];
+      auto sequence = slot->sequence.load(std::memory_order_acquire);
+      auto diff = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(pos);
+      if (diff == 0) {
+        if (_sendPos.compare_exchange_weak(pos, pos + 1,
+                                           std::memory_order_relaxed)) {
+          break;
+        }
+      } else if (diff < 0) {
+        return false;
+      } else {
+        pos = _sendPos.load(std::memory_order_relaxed);
+      }
+    }
+    slot->value = value;
+    slot->sequence.store(pos + 1, std::memory_order_release);
+    wakeOne(_receiveWaiters, _receiveWaiterCount);
+    return true;
+  }
+
+  /**
+   Takes the oldest value from the ring
+   @return False if the channel is empty
+   */
+  bool pop(std::shared_ptr<JsiWrapper> &value) {
+    auto pos = _receivePos.load(std::memory_order_relaxed);
+    Slot *slot;
+    while (true) {
+      slot = &_slots[pos % _capacity];
+      auto sequence = slot->sequence.load(std::memory_order_acquire);
+      auto diff =
+          static_cast<intptr_t>(sequence) - static_cast<intptr_t>(pos + 1);
+      if (diff == 0) {
+        if (_receivePos.compare_exchange_weak(pos, pos + 1,
+                                              std::memory_order_relaxed)) {
+          break;
+        }
+      } else if (diff < 0) {
+        return false;
+      } else {
+        pos = _receivePos.load(std::memory_order_relaxed);
+      }
+    }
+    value = std::move(slot->value);
+    slot->value = nullptr;
+    slot->sequence.store(pos + _capacity, std::memory_order_release);
+    wakeOne(_sendWaiters, _sendWaiterCount);
+    return true;
+  }
+
+  /**
+   Tries to complete a waiter
+   @return False if the channel was empty (receivers) or full (senders)
+   */
+  bool tryComplete(jsi::Runtime &runtime, const std::shared_ptr<Waiter> &waiter) {
+    if (waiter->value != nullptr) {
+      if (!push(waiter->value)) {
+        return false;
+      }
+      waiter->promise->resolve(runtime, jsi::Value::undefined());
+      return true;
+    }
+    std::shared_ptr<JsiWrapper> wrapper;
+    if (!pop(wrapper)) {
+      return false;
+    }
+    waiter->promise->resolve(runtime, wrapper->unwrap(runtime));
+    return true;
+  }
+
+  std::deque<std::shared_ptr<Waiter>> &getWaiters(const Waiter &waiter) {
+    return waiter.value != nullptr ? _sendWaiters : _receiveWaiters;
+  }
+
+  std::atomic<size_t> &getWaiterCount(const Waiter &waiter) {
+    return waiter.value != nullptr ? _sendWaiterCount : _receiveWaiterCount;
+  }
+
+  /**
+   Returns true if the waiter could complete now
+   */
+  bool isReady(const Waiter &waiter) {
+    if (waiter.value != nullptr) {
+      auto pos = _sendPos.load();
+      return _slots[pos % _capacity].sequence.load() == pos;
+    }
+    auto pos = _receivePos.load();
+    return _slots[pos % _capacity].sequence.load() == pos + 1;
+  }
+
+  /**
+   Parks a waiter until the channel changes. The waiter is registered before
+   checking the channel again, so that a push or pop racing with it is either
+   seen by the check or sees the waiter.
+   */
+  void park(jsi::Runtime &runtime, std::shared_ptr<Waiter> waiter) {
+    auto &waiters = getWaiters(*waiter);
+    auto &waiterCount = getWaiterCount(*waiter);
+    while (true) {
+      {
+        std::lock_guard<std::mutex> lock(_waitersMutex);
+        waiters.push_back(waiter);
+        waiterCount++;
+      }
+      std::atomic_thread_fence(std::memory_order_seq_cst);
+      if (!isReady(*waiter)) {
+        return;
+      }
+      // The channel changed while parking, take the waiter back unless a
+      // wake up already did
+      {
+        std::lock_guard<std::mutex> lock(_waitersMutex);
+        auto it = std::find(waiters.begin(), waiters.end(), waiter);
+        if (it == waiters.end()) {
+          return;
+        }
+        waiters.erase(it);
+        waiterCount--;
+      }
+      if (tryComplete(runtime, waiter)) {
+        return;
+      }
+    }
+  }
+
+  /**
+   Retries a woken waiter on its thread, parking it again if another sender
+   or receiver was faster
+   */
+  void resume(std::shared_ptr<Waiter> waiter) {
+    auto context = waiter->context.lock();
+    if (context == nullptr) {
+      return;
+    }
+    auto self = shared_from_this();
+    auto retry = [self, waiter](jsi::Runtime &runtime) {
+      if (!self->tryComplete(runtime, waiter)) {
+        self->park(runtime, waiter);
+      }
+    };
+    if (waiter->isJsThread) {
+      context->invokeOnJsThread(std::move(retry));
+    } else {
+      context->invokeOnWorkletThread(
+          [retry](JsiWorkletContext *, jsi::Runtime &runtime) {
+            retry(runtime);
+          });
+    }
+  }
+
+  /**
+   Resumes the oldest parked waiter. Costs an atomic load when nobody waits,
+   which is always the case while receivers keep up with senders.
+   */
+  void wakeOne(std::deque<std::shared_ptr<Waiter>> &waiters,
+               std::atomic<size_t> &waiterCount) {
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (waiterCount.load() == 0) {
+      return;
+    }
+    std::shared_ptr<Waiter> waiter;
+    {
+      std::lock_guard<std::mutex> lock(_waitersMutex);
+      if (waiters.empty()) {
+        return;
+      }
+      waiter = waiters.front();
+      waiters.pop_front();
+      waiterCount--;
+    }
+    resume(waiter);
+  }
+
+  const size_t _capacity;
+  std::unique_ptr<Slot[]> _slots;
+  std::atomic<size_t> _sendPos = {0};
+  std::atomic<size_t> _receivePos = {0};
+
+  std::mutex _waitersMutex;
+  std::deque<std::shared_ptr<Waiter>> _sendWaiters;
+  std::deque<std::shared_ptr<Waiter>> _receiveWaiters;
+  std::atomic<size_t> _sendWaiterCount = {0};
+  std::atomic<size_t> _receiveWaiterCount = {0};
+};
+
+} // namespace RNWorklet
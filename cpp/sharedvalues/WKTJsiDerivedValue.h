@@ -0,0 +1,204 @@
+#pragma once
+
+#include <jsi/jsi.h>
+
+#include <chrono>
+#include <cstdint>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "WKTJsiHostObject.h"
+#include "WKTJsiSharedValue.h"
+#include "WKTJsiWorklet.h"
+#include "WKTJsiWorkletContext.h"
+#include "WKTJsiWrapper.h"
+
+namespace RNWorklet {
+
+namespace jsi = facebook::jsi;
+
+/**
+ Value computed by a worklet from other shared values. The result is cached
+ as a detached wrapper and only recomputed when it is read after one of its
+ dependencies changed. Readers outside of the context share one computation
+ per change and get the last value until it has finished.
+
+ Dependencies are tracked through the version counters that the notify chain
+ of their wrappers increments, which costs one atomic load per dependency on
+ each read and keeps working when a dependency's value is replaced.
+ */
+class JsiDerivedValue : public JsiHostObject {
+public:
+  /**
+   Constructs a derived value
+   @param runtime Runtime of the worklet
+   @param worklet Worklet computing the value
+   @param dependencies Shared values the worklet reads
+   @param context Context to compute in, or nullptr to compute in the reading
+   runtime
+   */
+  JsiDerivedValue(jsi::Runtime &runtime, const jsi::Value &worklet,
+                  std::vector<std::shared_ptr<JsiSharedValue>> dependencies,
+                  std::shared_ptr<JsiWorkletContext> context)
+      : _invoker(std::make_shared<WorkletInvoker>(runtime, worklet)),
+        _dependencies(std::move(dependencies)), _context(context) {}
+
+  JSI_PROPERTY_GET(value) { return getValue(runtime)->unwrap(runtime); }
+
+  JSI_EXPORT_PROPERTY_GETTERS(JSI_EXPORT_PROP_GET(JsiDerivedValue, value))
+
+  /**
+   Returns the wrapped value, recomputing it if a dependency changed since it
+   was last computed. No lock is held while computing, so readers on the
+   thread of the context compute inline instead of waiting for a computation
+   that is queued behind them. Readers on other threads get the last value
+   while the recomputation runs on the context, only the first read waits
+   for it.
+   @param runtime Runtime of the reader
+   */
+  std::shared_ptr<JsiWrapper> getValue(jsi::Runtime &runtime) {
+    // Versions are read before computing so that changes made while
+    // computing mark the result as stale
+    auto versions = getVersions();
+    auto context = _context.lock();
+    auto computeInline = context == nullptr ||
+                         JsiWorkletContext::getCurrent(runtime) == context.get();
+
+    Computation computation;
+    {
+      std::lock_guard<std::mutex> lock(_mutex);
+      takeFinishedComputation(runtime);
+      if (_value != nullptr && versions == _versions) {
+        return _value;
+      }
+      if (!computeInline) {
+        // Readers on other threads share one computation per change
+        if (!_computation.valid() || _computationVersions != versions) {
+          _computation = computeInContext(context);
+          _computationVersions = versions;
+        }
+        if (_value != nullptr) {
+          return _value;
+        }
+        computation = _computation;
+      }
+    }
+
+    Result result;
+    if (computeInline) {
+      result = {compute(runtime), ""};
+    } else {
+      result = computation.get();
+    }
+
+    std::lock_guard<std::mutex> lock(_mutex);
+    if (_computation.valid() && _computationVersions == versions) {
+      _computation = Computation();
+    }
+    if (result.first == nullptr) {
+      throw jsi::JSError(runtime, result.second);
+    }
+    if (_value == nullptr || isNewer(versions, _versions)) {
+      _value = result.first;
+      _versions = std::move(versions);
+    }
+    return result.first;
+  }
+
+private:
+  /**
+   Computed value, or nullptr and the error message
+   */
+  using Result = std::pair<std::shared_ptr<JsiWrapper>, std::string>;
+  using Computation = std::shared_future<Result>;
+
+  /**
+   Stores the result of a finished computation in the context. Caller must
+   hold the lock.
+   */
+  void takeFinishedComputation(jsi::Runtime &runtime) {
+    if (!_computation.valid() ||
+        _computation.wait_for(std::chrono::seconds(0)) !=
+            std::future_status::ready) {
+      return;
+    }
+    auto result = _computation.get();
+    auto versions = std::move(_computationVersions);
+    _computation = Computation();
+    if (result.first == nullptr) {
+      throw jsi::JSError(runtime, result.second);
+    }
+    if (_value == nullptr || isNewer(versions, _versions)) {
+      _value = result.first;
+      _versions = std::move(versions);
+    }
+  }
+
+  /**
+   Returns true if the versions were read after the other versions, versions
+   only increase
+   */
+  static bool isNewer(const std::vector<uint64_t> &versions,
+                      const std::vector<uint64_t> &other) {
+    for (size_t i = 0; i < versions.size(); i++) {
+      if (versions[i] < other[i]) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  std::vector<uint64_t> getVersions() {
+    std::vector<uint64_t> versions;
+    versions.reserve(_dependencies.size());
+    for (auto &dependency : _dependencies) {
+      versions.push_back(dependency->getVersion());
+    }
+    return versions;
+  }
+
+  std::shared_ptr<JsiWrapper> compute(jsi::Runtime &runtime) {
+    auto result = _invoker->call(runtime, jsi::Value::undefined(), nullptr, 0);
+    return JsiWrapper::wrap(runtime, result);
+  }
+
+  /**
+   Schedules computing the value on the thread of the context
+   */
+  Computation computeInContext(std::shared_ptr<JsiWorkletContext> context) {
+    auto result = std::make_shared<std::promise<Result>>();
+    auto computation = result->get_future().share();
+    auto invoker = _invoker;
+    auto computeAndSet = [invoker, result](jsi::Runtime &runtime) {
+      try {
+        auto value = invoker->call(runtime, jsi::Value::undefined(), nullptr, 0);
+        result->set_value({JsiWrapper::wrap(runtime, value), ""});
+      } catch (const jsi::JSError &err) {
+        result->set_value({nullptr, err.getMessage()});
+      } catch (const std::exception &err) {
+        result->set_value({nullptr, err.what()});
+      }
+    };
+    context->invokeOnWorkletThread(
+        [computeAndSet](JsiWorkletContext *, jsi::Runtime &runtime) {
+          computeAndSet(runtime);
+        });
+    return computation;
+  }
+
+  std::shared_ptr<WorkletInvoker> _invoker;
+  std::vector<std::shared_ptr<JsiSharedValue>> _dependencies;
+  std::weak_ptr<JsiWorkletContext> _context;
+
+  std::mutex _mutex;
+  std::shared_ptr<JsiWrapper> _value;
+  std::vector<uint64_t> _versions;
+  Computation _computation;
+  std::vector<uint64_t> _computationVersions;
+};
+
+} // namespace RNWorklet
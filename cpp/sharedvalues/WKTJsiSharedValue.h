@@ -3,11 +3,15 @@
 #include <jsi/jsi.h>
 #include <map>
 
+#include <atomic>
 #include <memory>
+#include <mutex>
+#include <unordered_set>
 
 #include "WKTJsiDispatcher.h"
 #include "WKTJsiHostObject.h"
 #include "WKTJsiWorkletContext.h"
+#include "WKTJsiWrapSession.h"
 #include "WKTJsiWrapper.h"
 
 namespace RNWorklet {
@@ -19,32 +23,75 @@ public:
   /**
    Constructs a shared value - which is a wrapped value that can be accessed in
    a thread safe across two javascript runtimes.
+   @param value Initial value
+   @param useLazyWrapping Wraps nested objects when they are first accessed
+   @param preserveReferences Wraps objects referenced from several places in
+   the value once
    */
-  explicit JsiSharedValue(const jsi::Value &value)
-      : _valueWrapper(JsiWrapper::wrap(
-            *JsiWorkletContext::getDefaultInstance()->getJsRuntime(), value,
-            nullptr, true)) {}
+  explicit JsiSharedValue(const jsi::Value &value, bool useLazyWrapping = false,
+                          bool preserveReferences = false)
+      : _useLazyWrapping(useLazyWrapping),
+        _preserveReferences(preserveReferences) {
+    setValueWrapper(wrapValue(
+        *JsiWorkletContext::getDefaultInstance()->getJsRuntime(), value));
+    std::lock_guard<std::mutex> lock(getInstancesMutex());
+    getInstances().insert(this);
+  }
 
   /**
     Destructor
    */
-  ~JsiSharedValue() { _valueWrapper = nullptr; }
+  ~JsiSharedValue() {
+    {
+      std::lock_guard<std::mutex> lock(getInstancesMutex());
+      getInstances().erase(this);
+    }
+    setValueWrapper(nullptr);
+  }
 
   JSI_HOST_FUNCTION(toString) {
     return jsi::String::createFromUtf8(runtime,
-                                       _valueWrapper->toString(runtime));
+                                       getValueWrapper()->toString(runtime));
   }
 
-  JSI_PROPERTY_GET(value) { return _valueWrapper->unwrap(runtime); }
+  JSI_PROPERTY_GET(value) { return getValueWrapper()->unwrap(runtime); }
 
   JSI_PROPERTY_SET(value) {
-    if (_valueWrapper->canUpdateValue(runtime, value)) {
-      _valueWrapper->updateValue(runtime, value);
+    auto current = getValueWrapper();
+    if (current->canUpdateValue(runtime, value)) {
+      current->updateValue(runtime, value);
     } else {
-      _valueWrapper = JsiWrapper::wrap(runtime, value, nullptr, true);
+      // The listeners move to the new wrapper, which notifies them once and
+      // continues the versions of the replaced one
+      auto wrapper = wrapValue(runtime, value);
+      wrapper->setVersion(current->getVersion());
+      setValueWrapper(wrapper);
+      current->moveListenersTo(*wrapper);
     }
   }
 
+  JSI_PROPERTY_GET(version) {
+    return static_cast<double>(getValueWrapper()->getVersion());
+  }
+
+  JSI_HOST_FUNCTION(valueIfChanged) {
+    if (count == 0 || !arguments[0].isNumber()) {
+      throw jsi::JSError(runtime,
+                         "valueIfChanged expects a version as its parameter.");
+    }
+    // The version is read before the value from the same wrapper, so the
+    // value is at least as new as the version returned with it
+    auto wrapper = getValueWrapper();
+    auto version = wrapper->getVersion();
+    if (static_cast<double>(version) <= arguments[0].asNumber()) {
+      return jsi::Value::undefined();
+    }
+    jsi::Object result(runtime);
+    result.setProperty(runtime, "value", wrapper->unwrap(runtime));
+    result.setProperty(runtime, "version", static_cast<double>(version));
+    return result;
+  }
+
   JSI_HOST_FUNCTION(addListener) {
     // Verify arguments
     if (arguments[0].isUndefined() || arguments[0].isNull() ||
@@ -54,15 +101,42 @@ public:
                          "addListener expects a function as its parameter.");
     }
 
+    auto sync = false;
+    auto withChanges = false;
+    std::vector<JsiPrimitiveKey> path;
+    if (count > 1 && arguments[1].isObject()) {
+      auto options = arguments[1].asObject(runtime);
+      auto syncProp = options.getProperty(runtime, "sync");
+      sync = syncProp.isBool() && syncProp.getBool();
+      auto changesProp = options.getProperty(runtime, "changes");
+      withChanges = changesProp.isBool() && changesProp.getBool();
+      path = getPath(runtime, options.getProperty(runtime, "path"));
+    }
+
     // Wrap the callback into a dispatcher with error handling. This
     // callback will always be called on the main js thread/runtime so we
     // can just use values directly.
     auto functionToCall = std::make_shared<jsi::Function>(
         arguments[0].asObject(runtime).asFunction(runtime));
 
+    // Changes are recorded until the listener is called
+    auto pendingChanges =
+        withChanges ? std::make_shared<PendingChanges>() : nullptr;
+    auto valueWrapper = getValueWrapper();
+    // Listeners move with the root when the value is replaced, so they look
+    // up the current root
+    std::weak_ptr<Root> weakRoot = _root;
+
     auto functionPtr =
-        [functionToCall](jsi::Runtime &rt, const jsi::Value &thisVal,
-                         const jsi::Value *args, size_t count) -> jsi::Value {
+        [functionToCall, pendingChanges,
+         weakRoot](jsi::Runtime &rt, const jsi::Value &thisVal,
+                   const jsi::Value *args, size_t count) -> jsi::Value {
+      jsi::Value changes;
+      if (pendingChanges != nullptr) {
+        changes = pendingChanges->toArray(rt, getValueWrapper(weakRoot));
+        args = &changes;
+        count = 1;
+      }
       if (thisVal.isObject()) {
         return functionToCall->callWithThis(rt, thisVal.asObject(rt), args,
                                             count);
@@ -85,24 +159,65 @@ public:
         });
 
     // Set up the callback to run on the correct runtime thread.
-    auto callback = std::make_shared<std::function<void()>>(dispatcher);
+    auto subscribed = std::make_shared<std::atomic<bool>>(true);
+    auto callback = std::make_shared<std::function<void()>>(
+        sync ? dispatcher
+             : createCoalescedCallback(runtime, dispatcher, subscribed));
 
-    auto listenerId = _valueWrapper->addListener(callback);
+    // Changes outside of the path are filtered out on the writing thread
+    // before anything is scheduled
+    size_t listenerId;
+    if (pendingChanges != nullptr || !path.empty()) {
+      listenerId = valueWrapper->addChangeListener(
+          std::make_shared<std::function<void(const JsiChange &)>>(
+              [pendingChanges, callback](const JsiChange &change) {
+                if (pendingChanges != nullptr) {
+                  pendingChanges->add(change);
+                }
+                (*callback)();
+              }),
+          std::move(path));
+    } else {
+      listenerId = valueWrapper->addListener(callback);
+    }
 
     // Return functionPtr for removing the observer
     return jsi::Function::createFromHostFunction(
         runtime, jsi::PropNameID::forUtf8(runtime, "unsubscribe"), 0,
         [=](jsi::Runtime &runtime, const jsi::Value &thisValue,
             const jsi::Value *arguments, size_t count) -> jsi::Value {
-          _valueWrapper->removeListener(listenerId);
+          subscribed->store(false);
+          auto wrapper = getValueWrapper(weakRoot);
+          if (wrapper != nullptr) {
+            wrapper->removeListener(listenerId);
+            wrapper->removeChangeListener(listenerId);
+          }
           return jsi::Value::undefined();
         });
   }
 
+  JSI_HOST_FUNCTION(getMemoryStats) {
+    return getMemoryStats().toObject(runtime);
+  }
+
+  JSI_HOST_FUNCTION(transaction) {
+    if (count == 0 || !arguments[0].isObject() ||
+        !arguments[0].asObject(runtime).isFunction(runtime)) {
+      throw jsi::JSError(runtime,
+                         "transaction expects a function as its parameter.");
+    }
+    auto scope = beginTransaction();
+    return arguments[0].asObject(runtime).asFunction(runtime).call(runtime);
+  }
+
   JSI_EXPORT_FUNCTIONS(JSI_EXPORT_FUNC(JsiSharedValue, toString),
-                       JSI_EXPORT_FUNC(JsiSharedValue, addListener))
+                       JSI_EXPORT_FUNC(JsiSharedValue, addListener),
+                       JSI_EXPORT_FUNC(JsiSharedValue, getMemoryStats),
+                       JSI_EXPORT_FUNC(JsiSharedValue, transaction),
+                       JSI_EXPORT_FUNC(JsiSharedValue, valueIfChanged))
 
-  JSI_EXPORT_PROPERTY_GETTERS(JSI_EXPORT_PROP_GET(JsiSharedValue, value))
+  JSI_EXPORT_PROPERTY_GETTERS(JSI_EXPORT_PROP_GET(JsiSharedValue, value),
+                              JSI_EXPORT_PROP_GET(JsiSharedValue, version))
   JSI_EXPORT_PROPERTY_SETTERS(JSI_EXPORT_PROP_SET(JsiSharedValue, value))
 
   /**
@@ -111,7 +226,7 @@ public:
    * @return id of the listener - used for removing the listener
    */
   size_t addListener(std::shared_ptr<std::function<void()>> listener) {
-    return _valueWrapper->addListener(listener);
+    return getValueWrapper()->addListener(listener);
   }
 
   /**
@@ -119,10 +234,225 @@ public:
    * @param listenerId id of listener to remove
    */
   void removeListener(size_t listenerId) {
-    _valueWrapper->removeListener(listenerId);
+    getValueWrapper()->removeListener(listenerId);
+  }
+
+  /**
+   Returns the version of the value, see JsiWrapper::getVersion
+   */
+  uint64_t getVersion() { return getValueWrapper()->getVersion(); }
+
+  /**
+   Starts a transaction on the value. Other threads accessing the value wait
+   until the returned scope ends, and listeners are notified once when it
+   ends.
+   */
+  std::unique_ptr<JsiWrapper::BatchScope> beginTransaction() {
+    return std::make_unique<JsiWrapper::BatchScope>(getValueWrapper());
+  }
+
+  /**
+   Returns the memory used by the wrappers of the shared value
+   */
+  JsiMemoryStats getMemoryStats() { return getValueWrapper()->getMemoryStats(); }
+
+  /**
+   Adds the memory used by the wrappers of the shared value to the counter
+   */
+  void getMemoryStats(JsiMemoryCounter &counter) {
+    getValueWrapper()->getMemoryStats(counter);
+  }
+
+  /**
+   Adds the memory used by all live shared values to the counter
+   @param counter Counter to add to
+   @return Number of live shared values
+   */
+  static size_t getAllMemoryStats(JsiMemoryCounter &counter) {
+    std::lock_guard<std::mutex> lock(getInstancesMutex());
+    for (auto instance : getInstances()) {
+      instance->getMemoryStats(counter);
+    }
+    return getInstances().size();
   }
 
 private:
-  std::shared_ptr<JsiWrapper> _valueWrapper;
+  /**
+   Returns the keys of a listener path, which is either a string with keys
+   separated by dots or an array of keys.
+   */
+  static std::vector<JsiPrimitiveKey> getPath(jsi::Runtime &runtime,
+                                              const jsi::Value &value) {
+    std::vector<JsiPrimitiveKey> path;
+    if (value.isString()) {
+      auto str = value.asString(runtime).utf8(runtime);
+      size_t start = 0;
+      while (!str.empty() && start <= str.size()) {
+        auto end = str.find('.', start);
+        if (end == std::string::npos) {
+          end = str.size();
+        }
+        JsiPrimitiveKey key;
+        key.type = JsiWrapperType::String;
+        key.stringValue = JsiSharedString::create(str.substr(start, end - start));
+        path.push_back(key);
+        start = end + 1;
+      }
+    } else if (value.isObject() && value.asObject(runtime).isArray(runtime)) {
+      auto keys = value.asObject(runtime).asArray(runtime);
+      size_t size = keys.size(runtime);
+      for (size_t i = 0; i < size; i++) {
+        JsiPrimitiveKey key;
+        if (!JsiPrimitiveKey::fromValue(runtime, keys.getValueAtIndex(runtime, i),
+                                        key)) {
+          throw jsi::JSError(runtime,
+                             "addListener expects path keys to be primitives.");
+        }
+        path.push_back(key);
+      }
+    } else if (!value.isUndefined()) {
+      throw jsi::JSError(runtime,
+                         "addListener expects path to be a string or an array.");
+    }
+    return path;
+  }
+
+  /**
+   Changes recorded for a listener that receives changes, until it is called
+   */
+  class PendingChanges {
+  public:
+    void add(const JsiChange &change) {
+      std::lock_guard<std::mutex> lock(_mutex);
+      _changes.push_back(change);
+    }
+
+    /**
+     Returns the recorded changes as an array of { path, value } objects and
+     clears them
+     @param runtime Runtime of the listener
+     @param root Current root wrapper of the shared value
+     */
+    jsi::Array toArray(jsi::Runtime &runtime, std::shared_ptr<JsiWrapper> root) {
+      std::vector<JsiChange> changes;
+      {
+        std::lock_guard<std::mutex> lock(_mutex);
+        changes.swap(_changes);
+      }
+      auto result = jsi::Array(runtime, changes.size());
+      for (size_t i = 0; i < changes.size(); i++) {
+        auto &change = changes[i];
+        auto path = jsi::Array(runtime, change.path.size());
+        for (size_t j = 0; j < change.path.size(); j++) {
+          path.setValueAtIndex(runtime, j, change.path[j].toValue(runtime));
+        }
+        auto value = change.value != nullptr ? change.value : root;
+        jsi::Object item(runtime);
+        item.setProperty(runtime, "path", path);
+        item.setProperty(runtime, "value", value != nullptr
+                                               ? value->unwrap(runtime)
+                                               : jsi::Value::undefined());
+        result.setValueAtIndex(runtime, i, item);
+      }
+      return result;
+    }
+
+  private:
+    std::mutex _mutex;
+    std::vector<JsiChange> _changes;
+  };
+
+  /**
+   Returns a listener callback that marks the listener as dirty and schedules
+   one delivery on the thread of the runtime the listener was added in.
+   Changes made before the scheduled delivery has run are coalesced into it.
+   @param runtime Runtime the listener was added in
+   @param deliver Calls the listener
+   @param subscribed Cleared when the listener is removed, pending deliveries
+   are dropped
+   */
+  static std::function<void()>
+  createCoalescedCallback(jsi::Runtime &runtime, std::function<void()> deliver,
+                          std::shared_ptr<std::atomic<bool>> subscribed) {
+    auto ctx = JsiWorkletContext::getCurrent(runtime);
+    auto isJsThread = ctx == nullptr;
+    std::weak_ptr<JsiWorkletContext> weakContext =
+        isJsThread ? JsiWorkletContext::getDefaultInstanceAsShared()
+                   : ctx->shared_from_this();
+    auto pending = std::make_shared<std::atomic<bool>>(false);
+
+    return [deliver, subscribed, weakContext, isJsThread, pending]() {
+      if (pending->exchange(true)) {
+        // A delivery is already scheduled
+        return;
+      }
+      auto context = weakContext.lock();
+      if (context == nullptr) {
+        return;
+      }
+      auto flush = [deliver, subscribed, pending]() {
+        // Changes made while the listener runs schedule a new delivery
+        pending->store(false);
+        if (subscribed->load()) {
+          deliver();
+        }
+      };
+      if (isJsThread) {
+        context->invokeOnJsThread([flush](jsi::Runtime &) { flush(); });
+      } else {
+        context->invokeOnWorkletThread(
+            [flush](JsiWorkletContext *, jsi::Runtime &) { flush(); });
+      }
+    };
+  }
+
+  static std::unordered_set<JsiSharedValue *> &getInstances() {
+    static std::unordered_set<JsiSharedValue *> instances;
+    return instances;
+  }
+
+  static std::mutex &getInstancesMutex() {
+    static std::mutex mutex;
+    return mutex;
+  }
+
+  /**
+   Wraps a new root value with the options of the shared value
+   */
+  std::shared_ptr<JsiWrapper> wrapValue(jsi::Runtime &runtime,
+                                        const jsi::Value &value) {
+    JsiWrapSession::Scope scope(runtime, _preserveReferences);
+    return JsiWrapper::wrap(runtime, value, nullptr, true, _useLazyWrapping);
+  }
+
+  /**
+   Holds the root wrapper, listeners keep a weak reference to it to reach the
+   current root after the value was replaced
+   */
+  struct Root {
+    std::shared_ptr<JsiWrapper> wrapper;
+  };
+
+  /**
+   The root wrapper is replaced by the setter while other threads read it,
+   so it is only accessed atomically
+   */
+  std::shared_ptr<JsiWrapper> getValueWrapper() const {
+    return std::atomic_load(&_root->wrapper);
+  }
+
+  static std::shared_ptr<JsiWrapper>
+  getValueWrapper(const std::weak_ptr<Root> &weakRoot) {
+    auto root = weakRoot.lock();
+    return root != nullptr ? std::atomic_load(&root->wrapper) : nullptr;
+  }
+
+  void setValueWrapper(std::shared_ptr<JsiWrapper> wrapper) {
+    std::atomic_store(&_root->wrapper, std::move(wrapper));
+  }
+
+  bool _useLazyWrapping;
+  bool _preserveReferences;
+  std::shared_ptr<Root> _root = std::make_shared<Root>();
 };
 } // namespace RNWorklet
@@ -0,0 +1,118 @@
+#pragma once
+
+#include <jsi/jsi.h>
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+
+#include "WKTJsiHostObject.h"
+#include "WKTJsiWrapper.h"
+
+namespace RNWorklet {
+
+namespace jsi = facebook::jsi;
+
+/**
+ Shared value for data produced on one thread and consumed on another, like
+ per frame state. Published values are copied into wrappers that rotate
+ through three buffers: the writer fills the back buffer and swaps it with
+ the middle one, the reader swaps the middle buffer with the front one when a
+ newer value was published. Writer and reader never wait for each other, and
+ the reader always sees the latest complete value. Once nothing else holds
+ the back buffer, values of the same shape are merged into its wrappers
+ instead of wrapped anew.
+
+ Writers are serialized with each other and readers with each other, so any
+ number of runtimes can publish and read.
+ */
+class JsiTripleBuffer : public JsiHostObject {
+public:
+  /**
+   Constructs a triple buffer
+   @param runtime Runtime of the initial value
+   @param value Initial value
+   */
+  JsiTripleBuffer(jsi::Runtime &runtime, const jsi::Value &value) {
+    _buffers[_front] = JsiWrapper::wrap(runtime, value);
+  }
+
+  JSI_HOST_FUNCTION(publish) {
+    jsi::Value undefined;
+    const jsi::Value &value = count > 0 ? arguments[0] : undefined;
+    std::lock_guard<std::mutex> lock(_writeMutex);
+    // Only the back buffer's own reference is left once readers dropped it
+    auto &back = _buffers[_back];
+    if (back != nullptr && back.use_count() == 1 &&
+        back->canUpdateValue(runtime, value)) {
+      back->updateValue(runtime, value);
+    } else {
+      back = JsiWrapper::wrap(runtime, value);
+    }
+    publishBack();
+    return jsi::Value::undefined();
+  }
+
+  JSI_HOST_FUNCTION(read) { return read()->unwrap(runtime); }
+
+  JSI_PROPERTY_GET(version) { return static_cast<double>(_version.load()); }
+
+  JSI_EXPORT_FUNCTIONS(JSI_EXPORT_FUNC(JsiTripleBuffer, publish),
+                       JSI_EXPORT_FUNC(JsiTripleBuffer, read))
+
+  JSI_EXPORT_PROPERTY_GETTERS(JSI_EXPORT_PROP_GET(JsiTripleBuffer, version))
+
+  /**
+   Publishes a wrapped value, replacing the value readers get
+   */
+  void publish(std::shared_ptr<JsiWrapper> wrapper) {
+    std::lock_guard<std::mutex> lock(_writeMutex);
+    _buffers[_back] = wrapper;
+    publishBack();
+  }
+
+  /**
+   Returns the latest published value
+   */
+  std::shared_ptr<JsiWrapper> read() {
+    std::lock_guard<std::mutex> lock(_readMutex);
+    if (_middle.load(std::memory_order_acquire) & Fresh) {
+      auto previous = _middle.exchange(_front, std::memory_order_acq_rel);
+      _front = previous & IndexMask;
+    }
+    return _buffers[_front];
+  }
+
+private:
+  /**
+   Swaps the filled back buffer with the middle one. The version is bumped
+   first, so a reader that gets the value sees at least its version. Caller
+   must hold the write lock.
+   */
+  void publishBack() {
+    _version++;
+    auto previous = _middle.exchange(_back | Fresh, std::memory_order_acq_rel);
+    _back = previous & IndexMask;
+  }
+
+  static constexpr uint8_t IndexMask = 0x3;
+  static constexpr uint8_t Fresh = 0x4;
+
+  std::shared_ptr<JsiWrapper> _buffers[3];
+
+  // Index of the middle buffer and whether it is newer than the front one
+  std::atomic<uint8_t> _middle = {1};
+
+  // Owned by the writer
+  std::mutex _writeMutex;
+  uint8_t _back = 2;
+
+  // Owned by the reader
+  std::mutex _readMutex;
+  uint8_t _front = 0;
+
+  std::atomic<uint64_t> _version = {0};
+};
+
+} // namespace RNWorklet
@@ -5,24 +5,51 @@
 
 #include <jsi/jsi.h>
 
+#include "WKTJsiWrapSession.h"
+#include "WKTJsiWrapper.h"
+
 namespace RNWorklet {
 
 namespace jsi = facebook::jsi;
 
 class ArgumentsWrapper {
 public:
+  /**
+   Wraps the arguments
+   @param runtime Runtime of the arguments
+   @param arguments Arguments to wrap
+   @param count Number of arguments
+   @param useLazyWrapping Wraps objects nested in the arguments when they are
+   first accessed
+   @param preserveReferences Wraps objects referenced from several places in
+   the arguments once
+   */
   ArgumentsWrapper(jsi::Runtime &runtime, const jsi::Value *arguments,
-                   size_t count)
+                   size_t count, bool useLazyWrapping = false,
+                   bool preserveReferences = false)
       : _count(count) {
     _arguments.resize(count);
+    // With preserved references, arguments referencing the same object share
+    // one wrapper
+    JsiWrapSession::Scope scope(runtime, preserveReferences);
     for (size_t i = 0; i < count; ++i) {
-      _arguments[i] = JsiWrapper::wrap(runtime, arguments[i]);
+      _arguments[i] = JsiWrapper::wrap(runtime, arguments[i], nullptr, false,
+                                       useLazyWrapping);
     }
   }
 
   size_t getCount() const { return _count; }
 
+  /**
+   Returns the wrappers of the arguments
+   */
+  const std::vector<std::shared_ptr<JsiWrapper>> &getWrappers() const {
+    return _arguments;
+  }
+
   std::vector<jsi::Value> getArguments(jsi::Runtime &runtime) const {
+    // Arguments referencing the same array get the same copy
+    JsiUnwrapSession::Scope scope(runtime);
     std::vector<jsi::Value> args(_count);
     for (size_t i = 0; i < _count; ++i) {
       args[i] = JsiWrapper::unwrap(runtime, _arguments.at(i));
@@ -3,11 +3,19 @@
 #include <jsi/jsi.h>
 
 #include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <limits>
 #include <memory>
+#include <optional>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 #include "WKTJsiHostObject.h"
+#include "WKTJsiSerializedValue.h"
+#include "WKTJsiWrapSession.h"
 #include "WKTJsiWrapper.h"
 
 namespace RNWorklet {
@@ -50,13 +58,146 @@ public:
     return true;
   }
 
+  /**
+   Parses a property name as an array index in a single pass. Index names are
+   short enough to live in the small string buffer, so resolving `arr[i]` does
+   not allocate or go through std::stoi.
+   @param name Property name
+   @param index Parsed index
+   @return True if the name is a valid array index
+   */
+  static bool tryParseIndex(const std::string &name, size_t &index) {
+    // Indices are at most 10 digits (2^32 - 2), and only "0" may start with 0
+    if (name.empty() || name.size() > 10 ||
+        (name.size() > 1 && name[0] == '0')) {
+      return false;
+    }
+    uint64_t result = 0;
+    for (char c : name) {
+      if (c < '0' || c > '9') {
+        return false;
+      }
+      result = result * 10 + static_cast<uint64_t>(c - '0');
+    }
+    if (result >= UINT32_MAX) {
+      return false;
+    }
+    index = static_cast<size_t>(result);
+    return true;
+  }
+
+  /**
+   Resolves a relative index as used by Array.prototype.at/slice, where
+   negative values count from the end of the array.
+   */
+  static size_t resolveRelativeIndex(double relative, size_t size) {
+    if (std::isnan(relative)) {
+      return 0;
+    }
+    relative = std::trunc(relative);
+    if (relative < 0) {
+      relative += static_cast<double>(size);
+      return relative < 0 ? 0 : static_cast<size_t>(relative);
+    }
+    return relative > static_cast<double>(size) ? size
+                                                 : static_cast<size_t>(relative);
+  }
+
+  /**
+   Stable merge sort of the first count items that only calls less(a, b) and
+   stays within bounds even if less is not a strict weak ordering, like the
+   sort of javascript engines
+   */
+  template <typename Less>
+  static void mergeSort(std::vector<size_t> &items, size_t count, Less less) {
+    std::vector<size_t> buffer(count);
+    for (size_t width = 1; width < count; width *= 2) {
+      for (size_t left = 0; left < count - width; left += 2 * width) {
+        auto middle = left + width;
+        auto right = std::min(middle + width, count);
+        size_t i = left, j = middle, k = 0;
+        while (i < middle && j < right) {
+          // Equal elements keep their order
+          buffer[k++] = less(items[j], items[i]) ? items[j++] : items[i++];
+        }
+        while (i < middle) {
+          buffer[k++] = items[i++];
+        }
+        while (j < right) {
+          buffer[k++] = items[j++];
+        }
+        std::copy(buffer.begin(), buffer.begin() + k, items.begin() + left);
+      }
+    }
+  }
+
+  /**
+   Converts an argument to a number like the javascript ToNumber operation
+   */
+  static double toNumber(jsi::Runtime &runtime, const jsi::Value &value) {
+    if (value.isNumber()) {
+      return value.getNumber();
+    }
+    if (value.isBool()) {
+      return value.getBool() ? 1 : 0;
+    }
+    if (value.isNull()) {
+      return 0;
+    }
+    if (value.isUndefined()) {
+      return NAN;
+    }
+    return runtime.global()
+        .getPropertyAsFunction(runtime, "Number")
+        .call(runtime, value)
+        .getNumber();
+  }
+
   JSI_HOST_FUNCTION(toStringImpl) {
     return jsi::String::createFromUtf8(runtime, toString(runtime));
   }
 
   JSI_PROPERTY_GET(length) {
     std::unique_lock lock(_readWriteMutex);
-    return static_cast<double>(_array.size());
+    return static_cast<double>(getLength());
+  }
+
+  JSI_HOST_FUNCTION(at) {
+    if (count == 0 || !arguments[0].isNumber()) {
+      throw jsi::JSError(runtime, "at expects a numeric index.");
+    }
+
+    std::unique_lock lock(_readWriteMutex);
+
+    auto relative = std::trunc(arguments[0].getNumber());
+    auto index = relative < 0 ? relative + static_cast<double>(getLength())
+                              : relative;
+    if (std::isnan(index) || index < 0 ||
+        index >= static_cast<double>(getLength())) {
+      return jsi::Value::undefined();
+    }
+    return unwrapElement(runtime, static_cast<size_t>(index));
+  }
+
+  JSI_HOST_FUNCTION(getRange) {
+    std::unique_lock lock(_readWriteMutex);
+
+    // Resolve range with the same semantics as Array.prototype.slice
+    auto start = count > 0 && arguments[0].isNumber()
+                     ? resolveRelativeIndex(arguments[0].getNumber(),
+                                            getLength())
+                     : 0;
+    auto end = count > 1 && arguments[1].isNumber()
+                   ? resolveRelativeIndex(arguments[1].getNumber(),
+                                          getLength())
+                   : getLength();
+
+    auto size = end > start ? end - start : 0;
+    auto result = jsi::Array(runtime, size);
+    for (size_t i = 0; i < size; i++) {
+      result.setValueAtIndex(runtime, i, unwrapElement(runtime, start + i));
+    }
+    return result;
   }
 
   JSI_HOST_FUNCTION(iterator) {
@@ -68,8 +209,8 @@ public:
       std::unique_lock lock(_readWriteMutex);
 
       auto retVal = jsi::Object(runtime);
-      if (index < _array.size()) {
-        retVal.setProperty(runtime, "value", _array[index]->unwrap(runtime));
+      if (index < getLength()) {
+        retVal.setProperty(runtime, "value", unwrapElement(runtime, index));
         retVal.setProperty(runtime, "done", false);
         index++;
       } else {
@@ -86,55 +227,88 @@ public:
     return iterator;
   }
 
+  JSI_HOST_FUNCTION(toFloat64Array) {
+    std::unique_lock lock(_readWriteMutex);
+
+    auto length = getLength();
+    auto float64ArrayCtor =
+        runtime.global().getPropertyAsFunction(runtime, "Float64Array");
+    auto result =
+        float64ArrayCtor
+            .callAsConstructor(runtime, static_cast<double>(length))
+            .asObject(runtime);
+    auto buffer = result.getProperty(runtime, "buffer")
+                      .asObject(runtime)
+                      .getArrayBuffer(runtime);
+    auto data = reinterpret_cast<double *>(buffer.data(runtime));
+
+    if (_isPacked) {
+      // Packed arrays are copied in one go
+      std::memcpy(data, _packed.data(), length * sizeof(double));
+    } else {
+      // Boxed arrays are converted element by element, non-numbers are NaN
+      for (size_t i = 0; i < length; i++) {
+        auto element = _array[i]->unwrap(runtime);
+        data[i] = element.isNumber() ? element.getNumber()
+                                     : std::numeric_limits<double>::quiet_NaN();
+      }
+    }
+    return result;
+  }
+
   JSI_HOST_FUNCTION(push) {
     std::unique_lock lock(_readWriteMutex);
 
     // Push all arguments to the array end
-    for (size_t i = 0; i < count; i++) {
-      _array.push_back(JsiWrapper::wrap(runtime, arguments[i], this,
-                                        getUseProxiesForUnwrapping()));
-    }
+    insertElements(runtime, getLength(), arguments, count);
     notify();
-    return static_cast<double>(_array.size());
+    return static_cast<double>(getLength());
   };
 
   JSI_HOST_FUNCTION(unshift) {
     std::unique_lock lock(_readWriteMutex);
 
     // Insert all arguments to the array beginning
-    for (size_t i = 0; i < count; i++) {
-      _array.insert(_array.begin(),
-                    JsiWrapper::wrap(runtime, arguments[i], this,
-                                     getUseProxiesForUnwrapping()));
-    }
+    insertElements(runtime, 0, arguments, count);
     notify();
-    return static_cast<double>(_array.size());
+    return static_cast<double>(getLength());
   };
 
   JSI_HOST_FUNCTION(pop) {
     std::unique_lock lock(_readWriteMutex);
 
     // Pop last element from array
-    if (_array.empty()) {
+    if (getLength() == 0) {
       return jsi::Value::undefined();
     }
-    auto lastEl = _array.at(_array.size() - 1);
-    _array.pop_back();
+    auto lastEl = unwrapElement(runtime, getLength() - 1);
+    updateValueIndex(getLength() - 1, getLength(), -1);
+    if (_isPacked) {
+      _packed.pop_back();
+    } else {
+      _array.pop_back();
+    }
     notify();
-    return lastEl->unwrap(runtime);
+    return lastEl;
   };
 
   JSI_HOST_FUNCTION(shift) {
     std::unique_lock lock(_readWriteMutex);
 
     // Shift first element from array
-    if (_array.empty()) {
+    if (getLength() == 0) {
       return jsi::Value::undefined();
     }
-    auto firstEl = _array.at(0);
-    _array.erase(_array.begin());
+    auto firstEl = unwrapElement(runtime, 0);
+    updateValueIndex(0, 1, -1);
+    if (_isPacked) {
+      _packed.erase(_packed.begin());
+    } else {
+      _array.erase(_array.begin());
+      recordIndices(0, _array.size());
+    }
     notify();
-    return firstEl->unwrap(runtime);
+    return firstEl;
   };
 
   JSI_HOST_FUNCTION(forEach) {
@@ -145,8 +319,8 @@ public:
     std::vector<jsi::Value> args(3);
     args[2] = thisValue.asObject(runtime);
     
-    for (size_t i = 0; i < _array.size(); i++) {
-      args[0] = _array.at(i)->unwrap(runtime);
+    for (size_t i = 0; i < getLength(); i++) {
+      args[0] = unwrapElement(runtime, i);
       args[1] = jsi::Value(static_cast<double>(i));
       callFunction(runtime, callbackFn, thisValue, static_cast<const jsi::Value *>(args.data()), 3);
     }
@@ -158,13 +332,13 @@ public:
     std::unique_lock lock(_readWriteMutex);
 
     auto callbackFn = arguments[0].asObject(runtime).asFunction(runtime);
-    auto result = jsi::Array(runtime, _array.size());
+    auto result = jsi::Array(runtime, getLength());
     
     std::vector<jsi::Value> args(3);
     args[2] = thisValue.asObject(runtime);
     
-    for (size_t i = 0; i < _array.size(); i++) {
-      args[0] = _array.at(i)->unwrap(runtime);
+    for (size_t i = 0; i < getLength(); i++) {
+      args[0] = unwrapElement(runtime, i);
       args[1] = jsi::Value(static_cast<double>(i));
       auto retVal = callFunction(runtime, callbackFn, thisValue,
                                  static_cast<const jsi::Value *>(args.data()), 3);
@@ -177,25 +351,26 @@ public:
     std::unique_lock lock(_readWriteMutex);
 
     auto callbackFn = arguments[0].asObject(runtime).asFunction(runtime);
-    std::vector<std::shared_ptr<JsiWrapper>> result;
+    std::vector<size_t> result;
     
     std::vector<jsi::Value> args(3);
     args[2] = thisValue.asObject(runtime);
 
-    for (size_t i = 0; i < _array.size(); i++) {
-      args[0] = _array.at(i)->unwrap(runtime);
+    for (size_t i = 0; i < getLength(); i++) {
+      args[0] = unwrapElement(runtime, i);
       args[1] = jsi::Value(static_cast<double>(i));
       
       auto retVal = callFunction(runtime, callbackFn, thisValue,
                                  static_cast<const jsi::Value *>(args.data()), 3);
 
       if (evaluateAsBoolean(runtime, retVal)) {
-        result.push_back(_array.at(i));
+        result.push_back(i);
       }
     }
     auto returnValue = jsi::Array(runtime, result.size());
     for (size_t i = 0; i < result.size(); i++) {
-      returnValue.setValueAtIndex(runtime, i, result.at(i)->unwrap(runtime));
+      returnValue.setValueAtIndex(runtime, i,
+                                  unwrapElement(runtime, result.at(i)));
     }
     return returnValue;
   };
@@ -208,14 +383,14 @@ public:
     std::vector<jsi::Value> args(3);
     args[2] = thisValue.asObject(runtime);
     
-    for (size_t i = 0; i < _array.size(); i++) {
-      args[0] = _array.at(i)->unwrap(runtime);
+    for (size_t i = 0; i < getLength(); i++) {
+      args[0] = unwrapElement(runtime, i);
       args[1] = jsi::Value(static_cast<double>(i));
       auto retVal = callFunction(runtime, callbackFn, thisValue,
                                  static_cast<const jsi::Value *>(args.data()), 3);
 
       if (evaluateAsBoolean(runtime, retVal)) {
-        return _array.at(i)->unwrap(runtime);
+        return unwrapElement(runtime, i);
       }
     }
     return jsi::Value::undefined();
@@ -229,8 +404,8 @@ public:
     std::vector<jsi::Value> args(3);
     args[2] = thisValue.asObject(runtime);
     
-    for (size_t i = 0; i < _array.size(); i++) {
-      args[0] = _array.at(i)->unwrap(runtime);
+    for (size_t i = 0; i < getLength(); i++) {
+      args[0] = unwrapElement(runtime, i);
       args[1] = jsi::Value(static_cast<double>(i));
       
       auto retVal = callFunction(runtime, callbackFn, thisValue,
@@ -251,8 +426,8 @@ public:
     std::vector<jsi::Value> args(3);
     args[2] = thisValue.asObject(runtime);
     
-    for (size_t i = 0; i < _array.size(); i++) {
-      args[0] = _array.at(i)->unwrap(runtime);
+    for (size_t i = 0; i < getLength(); i++) {
+      args[0] = unwrapElement(runtime, i);
       args[1] = jsi::Value(static_cast<double>(i));
       
       auto retVal = callFunction(runtime, callbackFn, thisValue,
@@ -273,8 +448,8 @@ public:
     std::vector<jsi::Value> args(3);
     args[2] = thisValue.asObject(runtime);
     
-    for (size_t i = 0; i < _array.size(); i++) {
-      args[0] = _array.at(i)->unwrap(runtime);
+    for (size_t i = 0; i < getLength(); i++) {
+      args[0] = unwrapElement(runtime, i);
       args[1] = jsi::Value(static_cast<double>(i));
       
       auto retVal = callFunction(runtime, callbackFn, thisValue,
@@ -290,56 +465,42 @@ public:
   JSI_HOST_FUNCTION(indexOf) {
     std::unique_lock lock(_readWriteMutex);
 
-    auto wrappedArg = JsiWrapper::wrap(runtime, arguments[0], nullptr,
-                                       getUseProxiesForUnwrapping());
-    
     size_t fromIndex = 0;
-    if (count == 2) {
-      fromIndex = arguments[1].asNumber();
+    if (count > 1 && arguments[1].isNumber()) {
+      fromIndex = resolveRelativeIndex(arguments[1].getNumber(), getLength());
     }
-    
-    for (size_t i = fromIndex; i < _array.size(); i++) {
-      // TODO: Add == operator to JsiWrapper
-      if (wrappedArg->getType() == _array[i]->getType()) {
-        if (wrappedArg->toString(runtime) == _array[i]->toString(runtime)) {
-          return static_cast<double>(i);
-        }
-      }
-    }
-    return -1;
+
+    jsi::Value undefined;
+    auto index = findElement(runtime, count > 0 ? arguments[0] : undefined,
+                             fromIndex, false);
+    return index != std::string::npos ? static_cast<double>(index) : -1;
   };
 
-  const std::vector<std::shared_ptr<JsiWrapper>>
-  flat_internal(int depth, std::vector<std::shared_ptr<JsiWrapper>> &arr) {
-    std::vector<std::shared_ptr<JsiWrapper>> result;
-    for (auto it : arr) {
-      if (it->getType() == JsiWrapperType::Array) {
+  void flat_internal(jsi::Runtime &runtime, int depth,
+                     std::vector<jsi::Value> &result) {
+    std::unique_lock lock(_readWriteMutex);
+    materialize();
+
+    for (size_t i = 0; i < getLength(); i++) {
+      if (!_isPacked && _array[i]->getType() == JsiWrapperType::Array) {
         // Recursively call flat untill depth equals 0
         if (depth <= -1 || depth > 0) {
-          auto childArray =
-              (static_cast<JsiArrayWrapper *>(it.get()))->getArray();
-          auto flattened = flat_internal(depth - 1, childArray);
-          for (auto child : flattened) {
-            result.push_back(child);
-          }
+          auto childArray = static_cast<JsiArrayWrapper *>(_array[i].get());
+          childArray->flat_internal(runtime, depth - 1, result);
         }
       } else {
-        result.push_back(it);
+        result.push_back(unwrapElement(runtime, i));
       }
     }
-    return result;
   }
 
   JSI_HOST_FUNCTION(flat) {
-    std::unique_lock lock(_readWriteMutex);
-
     auto depth = count > 0 ? arguments[0].asNumber() : -1;
-    std::vector<std::shared_ptr<JsiWrapper>> result =
-        flat_internal(depth, _array);
+    std::vector<jsi::Value> result;
+    flat_internal(runtime, depth, result);
     auto returnValue = jsi::Array(runtime, result.size());
     for (size_t i = 0; i < result.size(); i++) {
-      returnValue.setValueAtIndex(runtime, i,
-                                  JsiWrapper::unwrap(runtime, result.at(i)));
+      returnValue.setValueAtIndex(runtime, i, std::move(result[i]));
     }
     return returnValue;
   };
@@ -347,75 +508,275 @@ public:
   JSI_HOST_FUNCTION(includes) {
     std::unique_lock lock(_readWriteMutex);
 
-    auto wrappedArg = JsiWrapper::wrap(runtime, arguments[0], nullptr,
-                                       getUseProxiesForUnwrapping());
-    
     size_t fromIndex = 0;
-    if (count == 2) {
-      fromIndex = arguments[1].asNumber();
+    if (count > 1 && arguments[1].isNumber()) {
+      fromIndex = resolveRelativeIndex(arguments[1].getNumber(), getLength());
     }
-    
-    for (size_t i = fromIndex; i < _array.size(); i++) {
-      // TODO: Add == operator to JsiWrapper!!!
-      if (wrappedArg->getType() == _array[i]->getType()) {
-        if (wrappedArg->toString(runtime) == _array[i]->toString(runtime)) {
-          return true;
-        }
-      }
+
+    jsi::Value undefined;
+    const jsi::Value &searchElement = count > 0 ? arguments[0] : undefined;
+
+    // Membership of the whole array is answered by the value index directly
+    JsiPrimitiveKey key;
+    if (_valueIndex != nullptr && fromIndex == 0 &&
+        JsiPrimitiveKey::fromValue(runtime, searchElement, key)) {
+      return _valueIndex->count(key) != 0;
     }
-    return false;
+
+    return findElement(runtime, searchElement, fromIndex, true) !=
+           std::string::npos;
   };
 
+  JSI_HOST_FUNCTION(enableValueIndex) {
+    std::unique_lock lock(_readWriteMutex);
+
+    if (_valueIndex == nullptr) {
+      _valueIndex = std::make_unique<ValueIndex>();
+      updateValueIndex(0, getLength(), 1);
+    }
+    return jsi::Value::undefined();
+  }
+
+  JSI_HOST_FUNCTION(disableValueIndex) {
+    std::unique_lock lock(_readWriteMutex);
+    _valueIndex = nullptr;
+    return jsi::Value::undefined();
+  }
+
   JSI_HOST_FUNCTION(concat) {
     std::unique_lock lock(_readWriteMutex);
 
     // Copy existing array
-    std::vector<std::shared_ptr<JsiWrapper>> nextArray;
-    nextArray.resize(_array.size());
-    
-    for (size_t i=0; i<_array.size(); i++) {
-      nextArray[i] = _array[i];
+    std::vector<jsi::Value> nextArray;
+    nextArray.reserve(getLength() + count);
+
+    for (size_t i = 0; i < getLength(); i++) {
+      nextArray.push_back(unwrapElement(runtime, i));
     }
-    
+
     // enumerate all the parameters and check for either value or sub array (only two levels)
-    for (size_t i=0; i<count; i++) {
-      if (arguments[0].isObject()) {
-        auto obj = arguments[0].asObject(runtime);
+    for (size_t i = 0; i < count; i++) {
+      if (arguments[i].isObject()) {
+        auto obj = arguments[i].asObject(runtime);
         if (obj.isArray(runtime)) {
           // We have an array - loop through and append all the array elements
           auto arr = obj.asArray(runtime);
           for (size_t n = 0; n < arr.size(runtime); n++) {
-            nextArray.push_back(JsiWrapper::wrap(runtime, arr.getValueAtIndex(runtime, n)));
+            nextArray.push_back(arr.getValueAtIndex(runtime, n));
           }
           // continue loop
           continue;
         }
       }
-      
+
       // Not an array, let's add item itself
-      nextArray.push_back(JsiWrapper::wrap(runtime, arguments[i]));
+      nextArray.push_back(jsi::Value(runtime, arguments[i]));
     }
-    
-    auto results = jsi::Array(runtime, static_cast<size_t>(nextArray.size()));
+
+    auto results = jsi::Array(runtime, nextArray.size());
 
     for (size_t i = 0; i < nextArray.size(); i++) {
-      results.setValueAtIndex(runtime, i,
-                              JsiWrapper::unwrap(runtime, nextArray[i]));
+      results.setValueAtIndex(runtime, i, std::move(nextArray[i]));
     }
 
     return results;
   }
 
+  JSI_HOST_FUNCTION(splice) {
+    // Like in JS, splice without arguments removes nothing
+    if (count == 0) {
+      return jsi::Array(runtime, 0);
+    }
+
+    std::unique_lock lock(_readWriteMutex);
+
+    auto length = getLength();
+    auto start = resolveRelativeIndex(toNumber(runtime, arguments[0]), length);
+    size_t deleteCount = length - start;
+    if (count > 1) {
+      auto requested = toNumber(runtime, arguments[1]);
+      // Clamp as a double, Infinity and huge counts don't fit in size_t
+      deleteCount = std::isnan(requested) || requested < 0
+                        ? 0
+                        : static_cast<size_t>(
+                              std::min(std::trunc(requested),
+                                       static_cast<double>(deleteCount)));
+    }
+    auto itemCount = count > 2 ? count - 2 : 0;
+
+    // Collect and remove deleted elements
+    auto removed = jsi::Array(runtime, deleteCount);
+    for (size_t i = 0; i < deleteCount; i++) {
+      removed.setValueAtIndex(runtime, i, unwrapElement(runtime, start + i));
+    }
+    updateValueIndex(start, start + deleteCount, -1);
+    if (_isPacked) {
+      _packed.erase(_packed.begin() + start,
+                    _packed.begin() + start + deleteCount);
+    } else {
+      _array.erase(_array.begin() + start,
+                   _array.begin() + start + deleteCount);
+    }
+
+    // Insert new items
+    if (itemCount > 0) {
+      insertElements(runtime, start, arguments + 2, itemCount);
+    } else {
+      recordIndices(start, getLength());
+    }
+
+    if (deleteCount > 0 || itemCount > 0) {
+      notify();
+    }
+    return removed;
+  }
+
+  JSI_HOST_FUNCTION(reverse) {
+    std::unique_lock lock(_readWriteMutex);
+
+    if (_isPacked) {
+      std::reverse(_packed.begin(), _packed.end());
+    } else {
+      std::reverse(_array.begin(), _array.end());
+      recordIndices(0, _array.size());
+    }
+    notify();
+    return jsi::Value(runtime, thisValue);
+  }
+
+  JSI_HOST_FUNCTION(fill) {
+    std::unique_lock lock(_readWriteMutex);
+
+    auto length = getLength();
+    auto start = count > 1 && arguments[1].isNumber()
+                     ? resolveRelativeIndex(arguments[1].getNumber(), length)
+                     : 0;
+    auto end = count > 2 && arguments[2].isNumber()
+                   ? resolveRelativeIndex(arguments[2].getNumber(), length)
+                   : length;
+    if (start >= end) {
+      return jsi::Value(runtime, thisValue);
+    }
+
+    updateValueIndex(start, end, -1);
+    if (_isPacked && count > 0 && arguments[0].isNumber()) {
+      std::fill(_packed.begin() + start, _packed.begin() + end,
+                arguments[0].getNumber());
+    } else {
+      boxElements(runtime);
+      jsi::Value undefined;
+      const jsi::Value &value = count > 0 ? arguments[0] : undefined;
+      if (value.isObject()) {
+        // Like in JS all filled slots reference the same object
+        auto element = JsiWrapper::wrap(runtime, value, this,
+                                        getUseProxiesForUnwrapping());
+        if (end - start > 1) {
+          element->setHasSharedReferences();
+        }
+        std::fill(_array.begin() + start, _array.begin() + end, element);
+      } else {
+        // Primitives get a node per slot so that slots change independently
+        for (size_t i = start; i < end; i++) {
+          _array[i] = JsiWrapper::wrap(runtime, value, this,
+                                       getUseProxiesForUnwrapping());
+        }
+      }
+      recordIndices(start, end);
+    }
+    updateValueIndex(start, end, 1);
+
+    notify();
+    return jsi::Value(runtime, thisValue);
+  }
+
+  JSI_HOST_FUNCTION(sort) {
+    std::unique_lock lock(_readWriteMutex);
+
+    auto length = getLength();
+    auto wasPacked = _isPacked;
+    std::vector<size_t> order(length);
+    for (size_t i = 0; i < length; i++) {
+      order[i] = i;
+    }
+
+    // Undefined elements are always sorted to the end
+    auto definedEnd = order.end();
+    if (!_isPacked) {
+      definedEnd =
+          std::stable_partition(order.begin(), order.end(), [&](size_t i) {
+            return _array[i]->getType() != JsiWrapperType::Undefined;
+          });
+    }
+
+    if (count > 0 && !arguments[0].isUndefined()) {
+      if (!arguments[0].isObject() ||
+          !arguments[0].asObject(runtime).isFunction(runtime)) {
+        throw jsi::JSError(runtime,
+                           "sort expects a function as its first parameter.");
+      }
+
+      // Unwrap each element once and call the comparator on the values
+      auto comparator = arguments[0].asObject(runtime).asFunction(runtime);
+      std::vector<jsi::Value> values;
+      values.reserve(length);
+      for (size_t i = 0; i < length; i++) {
+        values.push_back(unwrapElement(runtime, i));
+      }
+      // Comparators may be inconsistent (random, NaN), which std::stable_sort
+      // does not allow
+      mergeSort(order, static_cast<size_t>(definedEnd - order.begin()),
+                [&](size_t a, size_t b) {
+                  auto result = comparator.call(runtime, values[a], values[b]);
+                  return result.isNumber() && result.getNumber() < 0;
+                });
+    } else {
+      // Default ordering compares the elements as UTF-16 strings. Keys are
+      // computed once per element instead of once per comparison.
+      std::vector<std::u16string> keys(length);
+      for (auto it = order.begin(); it != definedEnd; it++) {
+        keys[*it] = getDefaultSortKey(runtime, *it);
+      }
+      std::stable_sort(order.begin(), definedEnd, [&](size_t a, size_t b) {
+        return keys[a] < keys[b];
+      });
+    }
+
+    // The comparator and string conversions run javascript, which may have
+    // changed the array through the recursive lock
+    if (getLength() != length || _isPacked != wasPacked) {
+      throw jsi::JSError(runtime, "The array was modified while sorting.");
+    }
+
+    // Move the existing elements into place, nothing is re-wrapped
+    if (_isPacked) {
+      std::vector<double> sorted(length);
+      for (size_t i = 0; i < length; i++) {
+        sorted[i] = _packed[order[i]];
+      }
+      _packed = std::move(sorted);
+    } else {
+      std::vector<std::shared_ptr<JsiWrapper>> sorted(length);
+      for (size_t i = 0; i < length; i++) {
+        sorted[i] = _array[order[i]];
+      }
+      _array = std::move(sorted);
+      recordIndices(0, _array.size());
+    }
+
+    notify();
+    return jsi::Value(runtime, thisValue);
+  }
+
   JSI_HOST_FUNCTION(join) {
     std::unique_lock lock(_readWriteMutex);
 
     auto separator =
         count > 0 ? arguments[0].asString(runtime).utf8(runtime) : ",";
     auto result = std::string("");
-    for (size_t i = 0; i < _array.size(); i++) {
-      auto arg = _array.at(i)->unwrap(runtime);
+    for (size_t i = 0; i < getLength(); i++) {
+      auto arg = unwrapElement(runtime, i);
       result += arg.toString(runtime).utf8(runtime);
-      if (i < _array.size() - 1) {
+      if (i < getLength() - 1) {
         result += separator;
       }
     }
@@ -437,9 +798,9 @@ public:
     std::vector<jsi::Value> args(4);
     args[3] = thisValue.asObject(runtime);
     
-    for (size_t i = 0; i < _array.size(); i++) {
+    for (size_t i = 0; i < getLength(); i++) {
       args[0] = acc->unwrap(runtime);
-      args[1] = _array.at(i)->unwrap(runtime);
+      args[1] = unwrapElement(runtime, i);
       args[2] = jsi::Value(static_cast<double>(i));
       acc = JsiWrapper::wrap(
           runtime,
@@ -453,6 +814,14 @@ public:
   JSI_EXPORT_PROPERTY_GETTERS(JSI_EXPORT_PROP_GET(JsiArrayWrapper, length))
 
   JSI_EXPORT_FUNCTIONS(
+      JSI_EXPORT_FUNC(JsiArrayWrapper, at),
+      JSI_EXPORT_FUNC(JsiArrayWrapper, getRange),
+      JSI_EXPORT_FUNC_NAMED(JsiArrayWrapper, getRange, slice),
+      JSI_EXPORT_FUNC(JsiArrayWrapper, splice),
+      JSI_EXPORT_FUNC(JsiArrayWrapper, reverse),
+      JSI_EXPORT_FUNC(JsiArrayWrapper, fill),
+      JSI_EXPORT_FUNC(JsiArrayWrapper, sort),
+      JSI_EXPORT_FUNC(JsiArrayWrapper, toFloat64Array),
       JSI_EXPORT_FUNC(JsiArrayWrapper, push),
       JSI_EXPORT_FUNC(JsiArrayWrapper, pop),
       JSI_EXPORT_FUNC(JsiArrayWrapper, unshift),
@@ -468,6 +837,8 @@ public:
       JSI_EXPORT_FUNC(JsiArrayWrapper, flat),
       JSI_EXPORT_FUNC(JsiArrayWrapper, includes),
       JSI_EXPORT_FUNC(JsiArrayWrapper, indexOf),
+      JSI_EXPORT_FUNC(JsiArrayWrapper, enableValueIndex),
+      JSI_EXPORT_FUNC(JsiArrayWrapper, disableValueIndex),
       JSI_EXPORT_FUNC(JsiArrayWrapper, join),
       JSI_EXPORT_FUNC(JsiArrayWrapper, reduce),
       JSI_EXPORT_FUNC_NAMED(JsiArrayWrapper, toStringImpl, toString),
@@ -485,10 +856,24 @@ public:
       return getArrayProxy(runtime, shared_from_this());
     }
 
-    // Copy array if we're not using proxies (shared values)
-    auto result = jsi::Array(runtime, _array.size());
-    for (size_t i = 0; i < _array.size(); i++) {
-      result.setValueAtIndex(runtime, i, _array.at(i)->unwrap(runtime));
+    std::unique_lock lock(_readWriteMutex);
+    materialize();
+
+    // Copy array if we're not using proxies (shared values). Shared elements
+    // are copied once per unwrap, and the copy is registered before the
+    // elements so that cycles resolve to it.
+    JsiUnwrapSession::Scope scope(runtime);
+    auto result = jsi::Array(runtime, getLength());
+    rememberUnwrapped(runtime, result);
+    if (_isPacked) {
+      // Packed numbers can be copied without going through child wrappers
+      for (size_t i = 0; i < _packed.size(); i++) {
+        result.setValueAtIndex(runtime, i, _packed[i]);
+      }
+    } else {
+      for (size_t i = 0; i < _array.size(); i++) {
+        result.setValueAtIndex(runtime, i, _array[i]->unwrap(runtime));
+      }
     }
     return result;
   }
@@ -497,6 +882,103 @@ public:
     return value.isObject() && value.asObject(runtime).isArray(runtime);
   }
 
+  /**
+   Sets the value from JSON created by JsiSerializedValue. The elements are
+   wrapped when the array is first accessed.
+   @param json Serialized array
+   */
+  void setSerializedValue(const std::string &json) {
+    std::unique_lock lock(_readWriteMutex);
+
+    _serialized = json;
+    _isPacked = true;
+    _packed.clear();
+    _array.clear();
+  }
+
+  /**
+   * Overridden mergeValue method. Packed numbers are compared in place and
+   * element wrappers are reused when they can hold the new element.
+   * @param runtime Calling runtime
+   * @param value Value to merge
+   * @return True if any element changed
+   */
+  bool mergeValue(jsi::Runtime &runtime, const jsi::Value &value) override {
+    std::unique_lock lock(_readWriteMutex);
+    materialize();
+
+    auto array = value.asObject(runtime).asArray(runtime);
+    size_t size = array.size(runtime);
+
+    std::vector<jsi::Value> elements;
+    elements.reserve(size);
+    bool allNumbers = true;
+    for (size_t i = 0; i < size; i++) {
+      elements.push_back(array.getValueAtIndex(runtime, i));
+      allNumbers = allNumbers && elements.back().isNumber();
+    }
+
+    // Register while merging so that cyclic values resolve to this wrapper
+    JsiWrapSession::Scope scope(runtime, getPreserveReferences());
+    auto session = JsiWrapSession::getCurrent(runtime);
+    auto id = session->add(runtime, array, shared_from_this());
+
+    bool changed = size != getLength();
+    if (_isPacked && allNumbers) {
+      _packed.resize(size);
+      for (size_t i = 0; i < size; i++) {
+        auto number = elements[i].getNumber();
+        if (!isSameNumber(_packed[i], number)) {
+          _packed[i] = number;
+          changed = true;
+        }
+      }
+    } else {
+      boxElements(runtime);
+      if (_array.size() > size) {
+        _array.erase(_array.begin() + size, _array.end());
+      }
+      for (size_t i = 0; i < size; i++) {
+        // Objects already wrapped in this session are shared
+        auto shared =
+            elements[i].isObject()
+                ? session->find(runtime, elements[i].getObject(runtime), this,
+                                getUseProxiesForUnwrapping())
+                : nullptr;
+        if (shared == nullptr && i < _array.size() &&
+            canMergeChild(runtime, _array[i], elements[i])) {
+          if (_array[i]->mergeValue(runtime, elements[i])) {
+            changed = true;
+          }
+          continue;
+        }
+        auto wrapped = shared != nullptr
+                           ? shared
+                           : JsiWrapper::wrap(runtime, elements[i], this,
+                                              getUseProxiesForUnwrapping());
+        if (i < _array.size() && _array[i] == wrapped) {
+          continue;
+        }
+        if (i < _array.size()) {
+          _array[i] = wrapped;
+        } else {
+          _array.push_back(wrapped);
+        }
+        recordIndices(i, i + 1);
+        changed = true;
+      }
+    }
+
+    session->complete(id);
+
+    // Rebuild the value index for the new contents
+    if (changed && _valueIndex != nullptr) {
+      _valueIndex->clear();
+      updateValueIndex(0, getLength(), 1);
+    }
+    return changed;
+  }
+
   /**
    * Overridden setValue method
    * @param runtime Calling runtime
@@ -511,11 +993,35 @@ public:
     auto array = object.asArray(runtime);
 
     size_t size = array.size(runtime);
-    _array.resize(size);
+
+    // Start out packed and fall back to boxed nodes on the first non-number
+    _serialized.reset();
+    _isPacked = true;
+    _packed.clear();
+    _array.clear();
+    _packed.reserve(size);
 
     for (size_t i = 0; i < size; i++) {
-      _array[i] = JsiWrapper::wrap(runtime, array.getValueAtIndex(runtime, i),
-                                   this, getUseProxiesForUnwrapping());
+      auto element = array.getValueAtIndex(runtime, i);
+      if (_isPacked && element.isNumber()) {
+        _packed.push_back(element.getNumber());
+        continue;
+      }
+      if (_isPacked) {
+        boxElements(runtime);
+        _array.reserve(size);
+      }
+      _array.push_back(JsiWrapper::wrap(runtime, element, this,
+                                        getUseProxiesForUnwrapping()));
+    }
+    if (!_isPacked) {
+      recordIndices(0, _array.size());
+    }
+
+    // Rebuild the value index for the new contents
+    if (_valueIndex != nullptr) {
+      _valueIndex->clear();
+      updateValueIndex(0, getLength(), 1);
     }
   }
 
@@ -527,21 +1033,44 @@ public:
    */
   void set(jsi::Runtime &runtime, const jsi::PropNameID &name,
            const jsi::Value &value) override {
-    auto nameStr = name.utf8(runtime);
-    if (!nameStr.empty() &&
-        std::all_of(nameStr.begin(), nameStr.end(), ::isdigit)) {
+    size_t index;
+    if (tryParseIndex(name.utf8(runtime), index)) {
       std::unique_lock lock(_readWriteMutex);
+      materialize();
 
-      // Return property by index
-      auto index = std::stoi(nameStr.c_str());
-      // Ensure we have the required length
-      if (index >= _array.size()) {
-        _array.resize(index + 1);
+      auto previousLength = getLength();
+      if (index < previousLength) {
+        updateValueIndex(index, index + 1, -1);
+      }
+
+      // Stay packed as long as we write numbers without creating holes
+      if (_isPacked && value.isNumber() && index <= _packed.size()) {
+        if (index == _packed.size()) {
+          _packed.push_back(value.getNumber());
+        } else {
+          _packed[index] = value.getNumber();
+        }
+        updateValueIndex(index, index + 1, 1);
+        notifyChild(index, value.getNumber());
+        return;
+      }
+
+      boxElements(runtime);
+
+      // Ensure we have the required length, holes are filled with undefined
+      while (index > getLength()) {
+        _array.push_back(JsiWrapper::wrap(runtime, jsi::Value::undefined(),
+                                          this, getUseProxiesForUnwrapping()));
+      }
+      if (index == getLength()) {
+        _array.emplace_back();
       }
       // Set value
-      _array[index] = JsiWrapper::wrap(runtime, value, nullptr,
+      _array[index] = JsiWrapper::wrap(runtime, value, this,
                                        getUseProxiesForUnwrapping());
-      notify();
+      recordIndices(std::min(index, previousLength), index + 1);
+      updateValueIndex(std::min(index, previousLength), index + 1, 1);
+      notifyChild(index, _array[index]);
     } else {
       // This is an edge case where the array is used as a
       // hashtable to set a value outside the bounds of the
@@ -558,15 +1087,18 @@ public:
    * @return Value
    */
   jsi::Value get(jsi::Runtime &runtime, const jsi::PropNameID &name) override {
-    auto nameStr = name.utf8(runtime);
-    if (!nameStr.empty() &&
-        std::all_of(nameStr.begin(), nameStr.end(), ::isdigit)) {
-      std::unique_lock lock(_readWriteMutex);
+    std::unique_lock lock(_readWriteMutex);
+    // Functions read the elements directly, so materialize for any property
+    materialize();
 
+    auto nameStr = name.utf8(runtime);
+    size_t index;
+    if (tryParseIndex(nameStr, index)) {
       // Return property by index
-      auto index = std::stoi(nameStr.c_str());
-      auto prop = _array[index];
-      return JsiWrapper::unwrap(runtime, prop);
+      if (index >= getLength()) {
+        return jsi::Value::undefined();
+      }
+      return unwrapElement(runtime, index);
     }
     // Return super JsiHostObject's get
     return JsiHostObject::get(runtime, name);
@@ -579,11 +1111,13 @@ public:
    */
   std::string toString(jsi::Runtime &runtime) override {
     std::unique_lock lock(_readWriteMutex);
+    materialize();
 
     std::string retVal = "";
     // Return array contents
-    for (size_t i = 0; i < _array.size(); i++) {
-      auto str = _array.at(i)->toString(runtime);
+    for (size_t i = 0; i < getLength(); i++) {
+      auto str = _isPacked ? numberToString(_packed[i])
+                           : _array.at(i)->toString(runtime);
       retVal += (i > 0 ? "," : "") + str;
     }
     return "[" + retVal + "]";
@@ -592,18 +1126,291 @@ public:
   std::vector<jsi::PropNameID>
   getPropertyNames(jsi::Runtime &runtime) override {
     std::unique_lock lock(_readWriteMutex);
+    materialize();
 
     std::vector<jsi::PropNameID> propNames;
-    propNames.reserve(_array.size());
-    for (size_t i = 0; i < _array.size(); i++) {
+    propNames.reserve(getLength());
+    for (size_t i = 0; i < getLength(); i++) {
       propNames.push_back(jsi::PropNameID::forUtf8(runtime, std::to_string(i)));
     }
     return propNames;
   }
 
-  const std::vector<std::shared_ptr<JsiWrapper>> &getArray() { return _array; }
+protected:
+  void recordChildKeys() override {
+    std::unique_lock lock(_readWriteMutex);
+    if (_isPacked) {
+      return;
+    }
+    for (size_t i = _array.size(); i-- > 0;) {
+      setKeyInParent(_array[i].get(), i);
+    }
+    for (auto &element : _array) {
+      recordKeysBelow(element.get());
+    }
+  }
+
+  std::shared_ptr<JsiWrapper> getSharedSelf() override {
+    return weak_from_this().lock();
+  }
+
+  void collectMemoryStats(JsiMemoryCounter &counter) override {
+    JsiWrapper::collectMemoryStats(counter);
+    counter.addBytes(sizeof(JsiArrayWrapper) - sizeof(JsiWrapper) +
+                     _packed.capacity() * sizeof(double) +
+                     _array.capacity() * sizeof(std::shared_ptr<JsiWrapper>));
+    if (_serialized.has_value()) {
+      counter.addString(*_serialized);
+    }
+    if (_valueIndex != nullptr) {
+      counter.addBytes(sizeof(ValueIndex) +
+                       _valueIndex->bucket_count() * sizeof(void *) +
+                       _valueIndex->size() * (sizeof(ValueIndex::value_type) +
+                                              sizeof(void *)));
+    }
+    for (auto &element : _array) {
+      element->getMemoryStats(counter);
+    }
+  }
 
 private:
+  /**
+   Wraps the elements of a serialized array. Caller must hold the lock.
+   */
+  void materialize() {
+    if (!_serialized.has_value()) {
+      return;
+    }
+    auto elements = JsiSerializedValue::parse(*_serialized);
+    _serialized.reset();
+
+    _isPacked = std::all_of(elements.begin(), elements.end(),
+                            [](const JsiSerializedElement &element) {
+                              return !element.isNested() &&
+                                     element.primitive.type ==
+                                         JsiWrapperType::Number;
+                            });
+    if (_isPacked) {
+      _packed.reserve(elements.size());
+      for (auto &element : elements) {
+        _packed.push_back(element.primitive.numberValue);
+      }
+    } else {
+      _array.reserve(elements.size());
+      for (auto &element : elements) {
+        _array.push_back(JsiWrapper::wrapSerialized(
+            element, this, getUseProxiesForUnwrapping()));
+      }
+      recordIndices(0, _array.size());
+    }
+    if (_valueIndex != nullptr) {
+      _valueIndex->clear();
+      updateValueIndex(0, getLength(), 1);
+    }
+  }
+
+  /**
+   Returns the number of elements in the array. Caller must hold the lock.
+   */
+  size_t getLength() { return _isPacked ? _packed.size() : _array.size(); }
+
+  /**
+   Returns the element at the given index as a value in the provided runtime.
+   Caller must hold the lock and ensure the index is within bounds.
+   */
+  jsi::Value unwrapElement(jsi::Runtime &runtime, size_t index) {
+    if (_isPacked) {
+      return jsi::Value(_packed[index]);
+    }
+    return _array[index]->unwrap(runtime);
+  }
+
+  /**
+   Converts packed number storage into boxed wrapper nodes. Called before
+   storing a value that is not a number. Caller must hold the lock.
+   */
+  void boxElements(jsi::Runtime &runtime) {
+    if (!_isPacked) {
+      return;
+    }
+    _array.clear();
+    _array.reserve(_packed.size());
+    for (auto number : _packed) {
+      _array.push_back(JsiWrapper::wrap(runtime, jsi::Value(number), this,
+                                        getUseProxiesForUnwrapping()));
+    }
+    _packed.clear();
+    _packed.shrink_to_fit();
+    _isPacked = false;
+    recordIndices(0, _array.size());
+  }
+
+  /**
+   Records the indices of the elements in the range as their keys while there
+   are change listeners. The first of several slots holding the same element
+   is recorded. Caller must hold the lock.
+   */
+  void recordIndices(size_t start, size_t end) {
+    if (_isPacked || start >= end || !hasChangeListeners()) {
+      return;
+    }
+    for (size_t i = end; i-- > start;) {
+      setKeyInParent(_array[i].get(), i);
+    }
+  }
+
+  /**
+   Inserts values at the given position, keeping the packed representation if
+   all values are numbers. Caller must hold the lock.
+   */
+  void insertElements(jsi::Runtime &runtime, size_t position,
+                      const jsi::Value *values, size_t count) {
+    if (_isPacked && std::all_of(values, values + count,
+                                 [](const jsi::Value &v) {
+                                   return v.isNumber();
+                                 })) {
+      std::vector<double> numbers(count);
+      for (size_t i = 0; i < count; i++) {
+        numbers[i] = values[i].getNumber();
+      }
+      _packed.insert(_packed.begin() + position, numbers.begin(),
+                     numbers.end());
+      updateValueIndex(position, position + count, 1);
+      return;
+    }
+
+    boxElements(runtime);
+    std::vector<std::shared_ptr<JsiWrapper>> wrapped(count);
+    for (size_t i = 0; i < count; i++) {
+      wrapped[i] = JsiWrapper::wrap(runtime, values[i], this,
+                                    getUseProxiesForUnwrapping());
+    }
+    _array.insert(_array.begin() + position, wrapped.begin(), wrapped.end());
+    recordIndices(position, _array.size());
+    updateValueIndex(position, position + count, 1);
+  }
+
+  /**
+   Returns the key used by the default sort order, which is the element's
+   string value as UTF-16. Integers and strings are converted natively, other
+   values are converted by the runtime. Caller must hold the lock.
+   */
+  std::u16string getDefaultSortKey(jsi::Runtime &runtime, size_t index) {
+    std::string str;
+    if (_isPacked && std::trunc(_packed[index]) == _packed[index] &&
+        std::abs(_packed[index]) < 1e18) {
+      // Javascript formats integers of this size without exponent or fraction
+      str = std::to_string(static_cast<int64_t>(_packed[index]));
+    } else if (!_isPacked &&
+               _array[index]->getType() == JsiWrapperType::String) {
+      str = _array[index]->toString(runtime);
+    } else {
+      str = unwrapElement(runtime, index).toString(runtime).utf8(runtime);
+    }
+    return utf8ToUtf16(str);
+  }
+
+  /**
+   Converts a UTF-8 string to UTF-16 so that strings can be ordered by code
+   units like in javascript.
+   */
+  static std::u16string utf8ToUtf16(const std::string &str) {
+    std::u16string result;
+    result.reserve(str.size());
+    for (size_t i = 0; i < str.size();) {
+      auto c = static_cast<unsigned char>(str[i]);
+      uint32_t codePoint;
+      size_t length;
+      if (c < 0x80) {
+        codePoint = c;
+        length = 1;
+      } else if ((c & 0xE0) == 0xC0) {
+        codePoint = c & 0x1F;
+        length = 2;
+      } else if ((c & 0xF0) == 0xE0) {
+        codePoint = c & 0x0F;
+        length = 3;
+      } else {
+        codePoint = c & 0x07;
+        length = 4;
+      }
+      for (size_t n = 1; n < length && i + n < str.size(); n++) {
+        codePoint = (codePoint << 6) | (str[i + n] & 0x3F);
+      }
+      i += length;
+
+      if (codePoint >= 0x10000) {
+        codePoint -= 0x10000;
+        result.push_back(static_cast<char16_t>(0xD800 + (codePoint >> 10)));
+        result.push_back(static_cast<char16_t>(0xDC00 + (codePoint & 0x3FF)));
+      } else {
+        result.push_back(static_cast<char16_t>(codePoint));
+      }
+    }
+    return result;
+  }
+
+  /**
+   Searches for a primitive value without converting elements to strings.
+   Objects are copied when wrapped and are therefore never found.
+   @param sameValueZero Use SameValueZero (includes) instead of strict
+   equality (indexOf), the only difference being that NaN is found.
+   @return Index of the element or std::string::npos if not found
+   */
+  size_t findElement(jsi::Runtime &runtime, const jsi::Value &value,
+                     size_t fromIndex, bool sameValueZero) {
+    JsiPrimitiveKey needle;
+    if (!JsiPrimitiveKey::fromValue(runtime, value, needle) ||
+        (!sameValueZero && needle.isNaN())) {
+      return std::string::npos;
+    }
+
+    // The value index lets us skip the scan for values not in the array
+    if (_valueIndex != nullptr && _valueIndex->count(needle) == 0) {
+      return std::string::npos;
+    }
+
+    if (_isPacked) {
+      for (size_t i = fromIndex; i < _packed.size(); i++) {
+        if (needle.equalsNumber(_packed[i])) {
+          return i;
+        }
+      }
+    } else {
+      for (size_t i = fromIndex; i < _array.size(); i++) {
+        if (_array[i]->equalsPrimitive(needle)) {
+          return i;
+        }
+      }
+    }
+    return std::string::npos;
+  }
+
+  /**
+   Adds (delta = 1) or removes (delta = -1) the primitive elements in the
+   range [from, to) to/from the value index if it is enabled. Caller must hold
+   the lock.
+   */
+  void updateValueIndex(size_t from, size_t to, int delta) {
+    if (_valueIndex == nullptr) {
+      return;
+    }
+    for (size_t i = from; i < to; i++) {
+      JsiPrimitiveKey key;
+      if (_isPacked) {
+        key.type = JsiWrapperType::Number;
+        key.numberValue = _packed[i];
+      } else if (!_array[i]->getPrimitiveKey(key)) {
+        continue;
+      }
+      auto &refCount = (*_valueIndex)[key];
+      refCount += delta;
+      if (refCount <= 0) {
+        _valueIndex->erase(key);
+      }
+    }
+  }
+
   /**
    Creates a proxy for the host object so that we can make the runtime trust
    that this is a real JS array
@@ -635,8 +1442,7 @@ private:
           "            return Reflect.set(target, prop, value, target);"
           "          },"
           "          get: function (_target, prop, receiver) {"
-          "            if (prop === 'length') return "
-          "Object.keys(target).length;"
+          "            if (prop === 'length') return target.length;"
           "            if (prop === 'keys') return Object.keys(target);"
           "            if (prop === 'values') return Object.values(target);"
           "            return Reflect.get(target, prop, receiver);"
@@ -666,6 +1472,25 @@ private:
         runtime, jsi::Object::createFromHostObject(runtime, hostObj));
   }
 
+  /**
+   Homogeneous number arrays are stored packed in _packed, all other arrays are
+   stored as one wrapper node per element in _array. Only one is in use.
+   */
+  bool _isPacked = true;
+  std::vector<double> _packed;
   std::vector<std::shared_ptr<JsiWrapper>> _array;
+
+  /**
+   JSON of a lazily wrapped array that has not been accessed yet
+   */
+  std::optional<std::string> _serialized;
+
+  /**
+   Optional reference counts of the primitive values in the array, used to
+   answer membership tests without scanning.
+   */
+  using ValueIndex =
+      std::unordered_map<JsiPrimitiveKey, int, JsiPrimitiveKey::Hash>;
+  std::unique_ptr<ValueIndex> _valueIndex;
 };
 } // namespace RNWorklet
@@ -0,0 +1,316 @@
+#pragma once
+
+#include <jsi/jsi.h>
+
+#include <list>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "WKTJsiHostObject.h"
+#include "WKTJsiWrapSession.h"
+#include "WKTJsiWrapper.h"
+
+namespace RNWorklet {
+
+namespace jsi = facebook::jsi;
+
+/**
+ Wraps a javascript Map with primitive keys. Entries are stored in insertion
+ order and looked up through a hash of the keys. Shared values unwrap to a host
+ object with the Map methods, copies unwrap to a real Map.
+ */
+class JsiMapWrapper : public JsiHostObject,
+                      public std::enable_shared_from_this<JsiMapWrapper>,
+                      public JsiWrapper {
+public:
+  /**
+   * Constructor
+   * @param parent optional parent wrapper
+   * @param useProxiesForUnwrapping unwraps using proxies
+   */
+  JsiMapWrapper(JsiWrapper *parent, bool useProxiesForUnwrapping)
+      : JsiWrapper(parent, useProxiesForUnwrapping, JsiWrapperType::Map) {}
+
+  JSI_HOST_FUNCTION(getImpl) {
+    std::unique_lock lock(_readWriteMutex);
+
+    auto it = _index.find(getKey(runtime, arguments, count));
+    if (it == _index.end()) {
+      return jsi::Value::undefined();
+    }
+    return it->second->value->unwrap(runtime);
+  }
+
+  JSI_HOST_FUNCTION(setImpl) {
+    std::unique_lock lock(_readWriteMutex);
+
+    auto key = getKey(runtime, arguments, count);
+    jsi::Value undefined;
+    auto wrapped = setEntry(runtime, key, count > 1 ? arguments[1] : undefined);
+    notifyChild(key, wrapped);
+    return jsi::Value(runtime, thisValue);
+  }
+
+  JSI_HOST_FUNCTION(has) {
+    std::unique_lock lock(_readWriteMutex);
+
+    return _index.count(getKey(runtime, arguments, count)) != 0;
+  }
+
+  JSI_HOST_FUNCTION(deleteImpl) {
+    std::unique_lock lock(_readWriteMutex);
+
+    auto it = _index.find(getKey(runtime, arguments, count));
+    if (it == _index.end()) {
+      return false;
+    }
+    _entries.erase(it->second);
+    _index.erase(it);
+    notify();
+    return true;
+  }
+
+  JSI_HOST_FUNCTION(clear) {
+    std::unique_lock lock(_readWriteMutex);
+
+    if (!_entries.empty()) {
+      _entries.clear();
+      _index.clear();
+      notify();
+    }
+    return jsi::Value::undefined();
+  }
+
+  JSI_HOST_FUNCTION(forEach) {
+    if (count == 0 || !arguments[0].isObject() ||
+        !arguments[0].asObject(runtime).isFunction(runtime)) {
+      throw createTypeError(runtime,
+                            "Map.prototype.forEach expects a function.");
+    }
+    std::unique_lock lock(_readWriteMutex);
+
+    auto callbackFn = arguments[0].asObject(runtime).asFunction(runtime);
+    jsi::Value undefined;
+    const jsi::Value &thisArg = count > 1 ? arguments[1] : undefined;
+
+    // Iterate a snapshot so that the callback can modify the map
+    std::vector<std::pair<JsiPrimitiveKey, std::shared_ptr<JsiWrapper>>>
+        entries;
+    entries.reserve(_entries.size());
+    for (auto &entry : _entries) {
+      entries.emplace_back(entry.key, entry.value);
+    }
+
+    std::vector<jsi::Value> args(3);
+    args[2] = thisValue.asObject(runtime);
+    for (auto &entry : entries) {
+      args[0] = entry.second->unwrap(runtime);
+      args[1] = entry.first.toValue(runtime);
+      callFunction(runtime, callbackFn, thisArg,
+                   static_cast<const jsi::Value *>(args.data()), 3);
+    }
+    return jsi::Value::undefined();
+  }
+
+  JSI_HOST_FUNCTION(keys) {
+    std::unique_lock lock(_readWriteMutex);
+
+    auto result = jsi::Array(runtime, _entries.size());
+    size_t i = 0;
+    for (auto &entry : _entries) {
+      result.setValueAtIndex(runtime, i++, entry.key.toValue(runtime));
+    }
+    return result;
+  }
+
+  JSI_HOST_FUNCTION(values) {
+    std::unique_lock lock(_readWriteMutex);
+
+    auto result = jsi::Array(runtime, _entries.size());
+    size_t i = 0;
+    for (auto &entry : _entries) {
+      result.setValueAtIndex(runtime, i++, entry.value->unwrap(runtime));
+    }
+    return result;
+  }
+
+  JSI_HOST_FUNCTION(entries) {
+    std::unique_lock lock(_readWriteMutex);
+
+    auto result = jsi::Array(runtime, _entries.size());
+    size_t i = 0;
+    for (auto &entry : _entries) {
+      auto pair = jsi::Array(runtime, 2);
+      pair.setValueAtIndex(runtime, 0, entry.key.toValue(runtime));
+      pair.setValueAtIndex(runtime, 1, entry.value->unwrap(runtime));
+      result.setValueAtIndex(runtime, i++, pair);
+    }
+    return result;
+  }
+
+  JSI_HOST_FUNCTION(toStringImpl) {
+    return jsi::String::createFromUtf8(runtime, toString(runtime));
+  }
+
+  JSI_PROPERTY_GET(size) {
+    std::unique_lock lock(_readWriteMutex);
+    return static_cast<double>(_entries.size());
+  }
+
+  JSI_EXPORT_FUNCTIONS(JSI_EXPORT_FUNC_NAMED(JsiMapWrapper, getImpl, get),
+                       JSI_EXPORT_FUNC_NAMED(JsiMapWrapper, setImpl, set),
+                       JSI_EXPORT_FUNC(JsiMapWrapper, has),
+                       JSI_EXPORT_FUNC_NAMED(JsiMapWrapper, deleteImpl,
+                                             delete),
+                       JSI_EXPORT_FUNC(JsiMapWrapper, clear),
+                       JSI_EXPORT_FUNC(JsiMapWrapper, forEach),
+                       JSI_EXPORT_FUNC(JsiMapWrapper, keys),
+                       JSI_EXPORT_FUNC(JsiMapWrapper, values),
+                       JSI_EXPORT_FUNC(JsiMapWrapper, entries),
+                       JSI_EXPORT_FUNC_NAMED(JsiMapWrapper, toStringImpl,
+                                             toString))
+
+  JSI_EXPORT_PROPERTY_GETTERS(JSI_EXPORT_PROP_GET(JsiMapWrapper, size))
+
+  bool canUpdateValue(jsi::Runtime &runtime, const jsi::Value &value) override {
+    return JsiWrapSession::getCollectionType(runtime, value) ==
+           JsiWrapperType::Map;
+  }
+
+  /**
+   * Overridden setValue
+   * @param runtime Value's runtime
+   * @param value Map to set
+   */
+  void setValue(jsi::Runtime &runtime, const jsi::Value &value) override {
+    std::unique_lock lock(_readWriteMutex);
+
+    _entries.clear();
+    _index.clear();
+
+    auto arrayFrom = runtime.global()
+                         .getPropertyAsObject(runtime, "Array")
+                         .getPropertyAsFunction(runtime, "from");
+    auto pairs = arrayFrom.call(runtime, value).asObject(runtime).asArray(runtime);
+    size_t size = pairs.size(runtime);
+    for (size_t i = 0; i < size; i++) {
+      auto pair = pairs.getValueAtIndex(runtime, i).asObject(runtime).asArray(
+          runtime);
+      JsiPrimitiveKey key;
+      if (!JsiPrimitiveKey::fromValue(runtime, pair.getValueAtIndex(runtime, 0),
+                                      key)) {
+        throw jsi::JSError(runtime,
+                           "Maps with object keys can not be shared.");
+      }
+      setEntry(runtime, key, pair.getValueAtIndex(runtime, 1));
+    }
+  }
+
+  /**
+   * Overridden getValue, returns the host object when using proxies and a
+   * copy of the map otherwise
+   * @param runtime Runtime to convert value into
+   */
+  jsi::Value getValue(jsi::Runtime &runtime) override {
+    if (getUseProxiesForUnwrapping()) {
+      return jsi::Object::createFromHostObject(runtime, shared_from_this());
+    }
+
+    std::unique_lock lock(_readWriteMutex);
+
+    // Register the copy before the values so that cycles resolve to it
+    JsiUnwrapSession::Scope scope(runtime);
+    auto map = runtime.global()
+                   .getPropertyAsFunction(runtime, "Map")
+                   .callAsConstructor(runtime)
+                   .asObject(runtime);
+    rememberUnwrapped(runtime, map);
+    auto set = map.getPropertyAsFunction(runtime, "set");
+    for (auto &entry : _entries) {
+      set.callWithThis(runtime, map, entry.key.toValue(runtime),
+                       entry.value->unwrap(runtime));
+    }
+    return map;
+  }
+
+  std::string toString(jsi::Runtime &runtime) override { return "[object Map]"; }
+
+protected:
+  void recordChildKeys() override {
+    std::unique_lock lock(_readWriteMutex);
+    for (auto &entry : _entries) {
+      setKeyInParent(entry.value.get(), entry.key);
+      recordKeysBelow(entry.value.get());
+    }
+  }
+
+  std::shared_ptr<JsiWrapper> getSharedSelf() override {
+    return weak_from_this().lock();
+  }
+
+  void collectMemoryStats(JsiMemoryCounter &counter) override {
+    JsiWrapper::collectMemoryStats(counter);
+    counter.addBytes(sizeof(JsiMapWrapper) - sizeof(JsiWrapper) +
+                     _index.bucket_count() * sizeof(void *));
+    for (auto &entry : _entries) {
+      // List node and index node
+      counter.addBytes(sizeof(Entry) + 2 * sizeof(void *) +
+                       sizeof(decltype(_index)::value_type) + sizeof(void *));
+      counter.addSharedString(entry.key.stringValue.get());
+      entry.value->getMemoryStats(counter);
+    }
+  }
+
+private:
+  struct Entry {
+    JsiPrimitiveKey key;
+    std::shared_ptr<JsiWrapper> value;
+  };
+
+  /**
+   Returns the key argument
+   */
+  JsiPrimitiveKey getKey(jsi::Runtime &runtime, const jsi::Value *arguments,
+                         size_t count) {
+    JsiPrimitiveKey key;
+    if (count > 0 && !JsiPrimitiveKey::fromValue(runtime, arguments[0], key)) {
+      throw jsi::JSError(runtime,
+                         "Only primitive keys are supported in shared Maps.");
+    }
+    return key;
+  }
+
+  /**
+   Adds or replaces an entry. Caller must hold the lock.
+   @return Wrapper of the value
+   */
+  std::shared_ptr<JsiWrapper> setEntry(jsi::Runtime &runtime,
+                                       JsiPrimitiveKey &key,
+                                       const jsi::Value &value) {
+    // -0 is stored as 0 like in a javascript Map
+    key.numberValue += 0.0;
+    auto wrapped =
+        JsiWrapper::wrap(runtime, value, this, getUseProxiesForUnwrapping());
+    if (hasChangeListeners()) {
+      setKeyInParent(wrapped.get(), key);
+    }
+    auto it = _index.find(key);
+    if (it != _index.end()) {
+      it->second->value = wrapped;
+      return wrapped;
+    }
+    _entries.push_back({key, wrapped});
+    _index.emplace(key, std::prev(_entries.end()));
+    return wrapped;
+  }
+
+  std::list<Entry> _entries;
+  std::unordered_map<JsiPrimitiveKey, std::list<Entry>::iterator,
+                     JsiPrimitiveKey::Hash>
+      _index;
+};
+
+} // namespace RNWorklet
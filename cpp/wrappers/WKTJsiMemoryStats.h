@@ -0,0 +1,92 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <unordered_set>
+
+#include <jsi/jsi.h>
+
+#include "WKTJsiSharedString.h"
+
+namespace RNWorklet {
+
+namespace jsi = facebook::jsi;
+
+/**
+ Estimated native memory used by wrapper nodes. Bytes include the nodes
+ themselves, their containers and string buffers, but not allocator or
+ control block overhead.
+ */
+struct JsiMemoryStats {
+  size_t bytes = 0;
+  size_t nodes = 0;
+
+  JsiMemoryStats operator-(const JsiMemoryStats &other) const {
+    return {bytes - other.bytes, nodes - other.nodes};
+  }
+
+  /**
+   Returns the stats as a javascript object with bytes and nodes
+   */
+  jsi::Object toObject(jsi::Runtime &runtime) const {
+    jsi::Object result(runtime);
+    result.setProperty(runtime, "bytes", static_cast<double>(bytes));
+    result.setProperty(runtime, "nodes", static_cast<double>(nodes));
+    return result;
+  }
+};
+
+/**
+ Accumulates memory stats while walking wrapper trees. Wrappers and string
+ buffers referenced from several places are counted once, so the difference
+ between two snapshots of one counter attributes shared memory to the first
+ root that reached it.
+ */
+class JsiMemoryCounter {
+public:
+  /**
+   Marks an allocation as counted
+   @return False if the allocation was counted before
+   */
+  bool visit(const void *ptr) { return _visited.insert(ptr).second; }
+
+  /**
+   Counts a wrapper node and its size
+   */
+  void addNode(size_t bytes) {
+    _stats.nodes++;
+    _stats.bytes += bytes;
+  }
+
+  /**
+   Counts memory owned by the current node
+   */
+  void addBytes(size_t bytes) { _stats.bytes += bytes; }
+
+  /**
+   Counts the heap buffer of a string, short strings are stored inline
+   */
+  void addString(const std::string &str) {
+    if (str.capacity() > std::string().capacity()) {
+      _stats.bytes += str.capacity() + 1;
+    }
+  }
+
+  /**
+   Counts a shared string buffer once
+   */
+  void addSharedString(const JsiSharedString *str) {
+    if (str != nullptr && visit(str)) {
+      _stats.bytes += sizeof(JsiSharedString);
+      addString(str->str());
+    }
+  }
+
+  const JsiMemoryStats &getStats() const { return _stats; }
+
+private:
+  JsiMemoryStats _stats;
+  std::unordered_set<const void *> _visited;
+};
+
+} // namespace RNWorklet
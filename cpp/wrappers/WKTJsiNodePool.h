@@ -0,0 +1,227 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <utility>
+#include <vector>
+
+namespace RNWorklet {
+
+/**
+ Free lists of fixed size blocks for wrapper nodes. Each thread allocates from
+ and frees to its own cache without locking. Caches hand batches of free
+ blocks to a shared pool when they grow and take batches back when they run
+ empty, so nodes allocated on one thread and released on another are recycled
+ instead of piling up on the releasing thread.
+
+ The shared pool keeps up to MaxSharedBlocks free blocks, blocks released
+ beyond that are returned to the system. Blocks are allocated one by one so
+ that each can be freed on its own.
+ */
+template <size_t BlockSize> class JsiNodePool {
+public:
+  static void *allocate() {
+    if (isCacheDestroyed()) {
+      return ::operator new(BlockSize);
+    }
+    auto &cache = getCache();
+    if (cache.head == nullptr) {
+      refill(cache);
+    }
+    auto block = cache.head;
+    cache.head = block->next;
+    cache.count--;
+    return block;
+  }
+
+  static void deallocate(void *ptr) {
+    auto block = static_cast<FreeBlock *>(ptr);
+    if (isCacheDestroyed()) {
+      // Released during thread exit, hand the block straight to the pool
+      block->next = nullptr;
+      getShared().push({block, 1});
+      return;
+    }
+    auto &cache = getCache();
+    block->next = cache.head;
+    cache.head = block;
+    cache.count++;
+    if (cache.count >= 2 * BatchSize) {
+      release(cache);
+    }
+  }
+
+private:
+  static constexpr size_t BatchSize = 64;
+  static constexpr size_t MaxSharedBlocks = 64 * BatchSize;
+
+  struct FreeBlock {
+    FreeBlock *next;
+  };
+
+  static_assert(BlockSize >= sizeof(FreeBlock), "Block size too small.");
+
+  struct Batch {
+    FreeBlock *head;
+    size_t count;
+  };
+
+  struct Shared {
+    std::mutex mutex;
+    std::vector<Batch> batches;
+    size_t blocks = 0;
+
+    void push(Batch batch) {
+      {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (blocks + batch.count <= MaxSharedBlocks) {
+          batches.push_back(batch);
+          blocks += batch.count;
+          return;
+        }
+      }
+      // The pool is full, free the batch outside of the lock
+      while (batch.head != nullptr) {
+        auto next = batch.head->next;
+        ::operator delete(batch.head);
+        batch.head = next;
+      }
+    }
+
+    bool pop(Batch &batch) {
+      std::lock_guard<std::mutex> lock(mutex);
+      if (batches.empty()) {
+        return false;
+      }
+      batch = batches.back();
+      batches.pop_back();
+      blocks -= batch.count;
+      return true;
+    }
+  };
+
+  struct Cache {
+    FreeBlock *head = nullptr;
+    size_t count = 0;
+
+    ~Cache() {
+      if (head != nullptr) {
+        getShared().push({head, count});
+      }
+      isCacheDestroyed() = true;
+    }
+  };
+
+  /**
+   The shared pool is never destroyed, so that nodes released by static
+   destructors can still be returned to it.
+   */
+  static Shared &getShared() {
+    static auto shared = new Shared();
+    return *shared;
+  }
+
+  static Cache &getCache() {
+    thread_local Cache cache;
+    return cache;
+  }
+
+  static bool &isCacheDestroyed() {
+    thread_local bool destroyed = false;
+    return destroyed;
+  }
+
+  /**
+   Takes a batch from the shared pool, or allocates a new one
+   */
+  static void refill(Cache &cache) {
+    Batch batch;
+    if (getShared().pop(batch)) {
+      cache.head = batch.head;
+      cache.count = batch.count;
+      return;
+    }
+    for (size_t i = 0; i < BatchSize; i++) {
+      auto block = static_cast<FreeBlock *>(::operator new(BlockSize));
+      block->next = cache.head;
+      cache.head = block;
+    }
+    cache.count = BatchSize;
+  }
+
+  /**
+   Moves a batch of blocks from the cache to the shared pool
+   */
+  static void release(Cache &cache) {
+    auto head = cache.head;
+    auto tail = head;
+    for (size_t i = 1; i < BatchSize; i++) {
+      tail = tail->next;
+    }
+    cache.head = tail->next;
+    cache.count -= BatchSize;
+    tail->next = nullptr;
+    getShared().push({head, BatchSize});
+  }
+};
+
+/**
+ Allocator that serves single objects from the node pool of their size class.
+ Used with std::allocate_shared so that a wrapper and its control block are
+ one pooled block.
+ */
+template <typename T> class JsiPoolAllocator {
+public:
+  using value_type = T;
+
+  JsiPoolAllocator() noexcept = default;
+
+  template <typename U>
+  JsiPoolAllocator(const JsiPoolAllocator<U> &) noexcept {} // NOLINT
+
+  T *allocate(size_t n) {
+    if (n != 1 || alignof(T) > alignof(std::max_align_t)) {
+      return static_cast<T *>(::operator new(n * sizeof(T)));
+    }
+    return static_cast<T *>(JsiNodePool<getBlockSize()>::allocate());
+  }
+
+  void deallocate(T *ptr, size_t n) {
+    if (n != 1 || alignof(T) > alignof(std::max_align_t)) {
+      ::operator delete(ptr);
+      return;
+    }
+    JsiNodePool<getBlockSize()>::deallocate(ptr);
+  }
+
+  template <typename U> bool operator==(const JsiPoolAllocator<U> &) const {
+    return true;
+  }
+
+  template <typename U> bool operator!=(const JsiPoolAllocator<U> &) const {
+    return false;
+  }
+
+private:
+  /**
+   Rounds the size up to the alignment of operator new, types of similar
+   size share one pool
+   */
+  static constexpr size_t getBlockSize() {
+    constexpr size_t alignment = alignof(std::max_align_t);
+    return (sizeof(T) + alignment - 1) / alignment * alignment;
+  }
+};
+
+/**
+ Creates a shared object in the node pool
+ */
+template <typename T, typename... Args>
+std::shared_ptr<T> makePooledShared(Args &&...args) {
+  return std::allocate_shared<T>(JsiPoolAllocator<T>(),
+                                 std::forward<Args>(args)...);
+}
+
+} // namespace RNWorklet
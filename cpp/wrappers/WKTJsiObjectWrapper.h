@@ -2,13 +2,18 @@
 
 #include <jsi/jsi.h>
 
+#include <algorithm>
 #include <map>
 #include <memory>
+#include <optional>
 #include <string>
 #include <vector>
 
+#include "WKTJsiNodePool.h"
 #include "WKTJsiPromiseWrapper.h"
+#include "WKTJsiSerializedValue.h"
 #include "WKTJsiWorklet.h"
+#include "WKTJsiWrapSession.h"
 #include "WKTJsiWrapper.h"
 
 namespace RNWorklet {
@@ -38,7 +43,9 @@ public:
                                              Symbol.toStringTag))
 
   bool canUpdateValue(jsi::Runtime &runtime, const jsi::Value &value) override {
-    return value.isObject() && !value.asObject(runtime).isArray(runtime);
+    return value.isObject() && !value.asObject(runtime).isArray(runtime) &&
+           JsiWrapSession::getCollectionType(runtime, value) ==
+               JsiWrapperType::Object;
   }
 
   /**
@@ -62,6 +69,56 @@ public:
     }
   }
 
+  /**
+   Sets the value from JSON created by JsiSerializedValue. The properties are
+   wrapped when the object is first accessed.
+   @param json Serialized object
+   */
+  void setSerializedValue(const std::string &json) {
+    std::unique_lock lock(_readWriteMutex);
+
+    setType(JsiWrapperType::Object);
+    _serialized = json;
+    _properties.clear();
+    _nativeState = nullptr;
+    _prototype = nullptr;
+  }
+
+  /**
+   * Overridden mergeValue. Plain objects are diffed property by property,
+   * other values replace the wrapped value.
+   * @param runtime Value's runtime
+   * @param value Value to merge
+   * @return True if the wrapped value changed
+   */
+  bool mergeValue(jsi::Runtime &runtime, const jsi::Value &value) override {
+    std::unique_lock lock(_readWriteMutex);
+
+    auto object = value.asObject(runtime);
+    if (object.isHostObject(runtime)) {
+      if (getType() == JsiWrapperType::HostObject &&
+          object.getHostObject(runtime) == _hostObject) {
+        return false;
+      }
+    } else if (getType() == JsiWrapperType::Object &&
+               _nativeState == nullptr && !object.isFunction(runtime) &&
+               !object.isArrayBuffer(runtime) &&
+               !object.hasNativeState(runtime)) {
+      materialize();
+
+      // Register while merging so that cyclic values resolve to this wrapper
+      JsiWrapSession::Scope scope(runtime, getPreserveReferences());
+      auto session = JsiWrapSession::getCurrent(runtime);
+      auto id = session->add(runtime, object, shared_from_this());
+      auto changed = mergeObjectValue(runtime, object);
+      session->complete(id);
+      return changed;
+    }
+
+    setValue(runtime, value);
+    return true;
+  }
+
   /**
    * Overridden get value where we convert from the internal representation to
    * a jsi value
@@ -120,9 +177,22 @@ public:
   void set(jsi::Runtime &runtime, const jsi::PropNameID &name,
            const jsi::Value &value) override {
     std::unique_lock lock(_readWriteMutex);
+    materialize();
 
     auto nameStr = name.utf8(runtime);
-    _properties[nameStr] = JsiWrapper::wrap(runtime, value, this, getUseProxiesForUnwrapping());
+    auto existing = _properties.find(nameStr);
+    if (existing != _properties.end() &&
+        canMergeChild(runtime, existing->second, value)) {
+      if (existing->second->mergeValue(runtime, value)) {
+        notifyChild(nameStr, existing->second);
+      }
+      return;
+    }
+    auto &property = _properties[nameStr];
+    property =
+        JsiWrapper::wrap(runtime, value, this, getUseProxiesForUnwrapping());
+    recordKey(nameStr, property.get(), hasChangeListeners());
+    notifyChild(nameStr, property);
   }
 
   /**
@@ -133,6 +203,7 @@ public:
    */
   jsi::Value get(jsi::Runtime &runtime, const jsi::PropNameID &name) override {
     std::unique_lock lock(_readWriteMutex);
+    materialize();
 
     auto nameStr = name.utf8(runtime);
     if (_properties.count(nameStr) != 0) {
@@ -151,6 +222,7 @@ public:
   std::vector<jsi::PropNameID>
   getPropertyNames(jsi::Runtime &runtime) override {
     std::unique_lock lock(_readWriteMutex);
+    materialize();
 
     std::vector<jsi::PropNameID> retVal;
     retVal.reserve(_properties.size());
@@ -181,6 +253,37 @@ public:
     }
   }
 
+protected:
+  void recordChildKeys() override {
+    std::unique_lock lock(_readWriteMutex);
+    for (auto &property : _properties) {
+      recordKey(property.first, property.second.get(), true);
+      recordKeysBelow(property.second.get());
+    }
+  }
+
+  std::shared_ptr<JsiWrapper> getSharedSelf() override {
+    return weak_from_this().lock();
+  }
+
+  void collectMemoryStats(JsiMemoryCounter &counter) override {
+    JsiWrapper::collectMemoryStats(counter);
+    counter.addBytes(sizeof(JsiObjectWrapper) - sizeof(JsiWrapper));
+    if (_serialized.has_value()) {
+      counter.addString(*_serialized);
+    }
+    for (auto &property : _properties) {
+      // Tree node with parent, left, right and color
+      counter.addBytes(sizeof(decltype(_properties)::value_type) +
+                       4 * sizeof(void *));
+      counter.addString(property.first);
+      property.second->getMemoryStats(counter);
+    }
+    if (_prototype != nullptr) {
+      _prototype->getMemoryStats(counter);
+    }
+  }
+
 private:
   void setArrayBufferValue(jsi::Runtime &runtime, jsi::Object &obj) {
     throw jsi::JSError(runtime,
@@ -191,16 +294,19 @@ private:
     std::unique_lock lock(_readWriteMutex);
     
     setType(JsiWrapperType::Object);
+    _serialized.reset();
     _properties.clear();
+    auto recordKeys = hasChangeListeners();
     auto propNames = obj.getPropertyNames(runtime);
     for (size_t i = 0; i < propNames.size(runtime); i++) {
       auto nameString =
           propNames.getValueAtIndex(runtime, i).asString(runtime).utf8(runtime);
 
       auto value = obj.getProperty(runtime, nameString.c_str());
-      _properties.emplace(
-          nameString,
-          JsiWrapper::wrap(runtime, value, this, getUseProxiesForUnwrapping()));
+      auto wrapped =
+          JsiWrapper::wrap(runtime, value, this, getUseProxiesForUnwrapping());
+      recordKey(nameString, wrapped.get(), recordKeys);
+      _properties.emplace(nameString, std::move(wrapped));
     }
     
     if (obj.hasNativeState(runtime)) {
@@ -212,7 +318,7 @@ private:
       jsi::Value prototype = getPrototypeOf.call(runtime, obj);
       if (prototype.isObject()) {
         jsi::Object prototypeObject = prototype.getObject(runtime);
-        _prototype = std::make_shared<JsiObjectWrapper>(nullptr, false);
+        _prototype = makePooledShared<JsiObjectWrapper>(nullptr, false);
         _prototype->setObjectValue(runtime, prototypeObject);
       }
     } else {
@@ -221,6 +327,116 @@ private:
     }
   }
 
+  /**
+   Wraps the properties of a serialized object. Caller must hold the lock.
+   */
+  void materialize() {
+    if (!_serialized.has_value()) {
+      return;
+    }
+    auto elements = JsiSerializedValue::parse(*_serialized);
+    _serialized.reset();
+    auto recordKeys = hasChangeListeners();
+    for (auto &element : elements) {
+      auto &property = _properties[element.key];
+      property = JsiWrapper::wrapSerialized(element, this,
+                                            getUseProxiesForUnwrapping());
+      recordKey(element.key, property.get(), recordKeys);
+    }
+  }
+
+  /**
+   Records the name of a property as the key of its wrapper. Names are only
+   recorded while there are change listeners, since a key is created for
+   each property. Caller must hold the lock.
+   @param name Name of the property
+   @param child Wrapper of the property
+   @param recordKeys Result of hasChangeListeners
+   */
+  void recordKey(const std::string &name, JsiWrapper *child, bool recordKeys) {
+    if (!recordKeys) {
+      return;
+    }
+    JsiPrimitiveKey key;
+    key.type = JsiWrapperType::String;
+    key.stringValue = JsiSharedString::create(name);
+    setKeyInParent(child, std::move(key));
+  }
+
+  /**
+   Updates the properties from a plain object in place, reusing the wrappers
+   of properties that still exist. Caller must hold the lock and a wrap
+   session.
+   @return True if any property changed
+   */
+  bool mergeObjectValue(jsi::Runtime &runtime, jsi::Object &obj) {
+    auto session = JsiWrapSession::getCurrent(runtime);
+    auto propNames = obj.getPropertyNames(runtime);
+    size_t count = propNames.size(runtime);
+
+    bool changed = false;
+    auto recordKeys = hasChangeListeners();
+    std::vector<std::string> names;
+    names.reserve(count);
+    for (size_t i = 0; i < count; i++) {
+      auto nameString =
+          propNames.getValueAtIndex(runtime, i).asString(runtime).utf8(runtime);
+
+      auto value = obj.getProperty(runtime, nameString.c_str());
+      auto existing = _properties.find(nameString);
+
+      // Objects already wrapped in this session are shared
+      auto shared = value.isObject()
+                        ? session->find(runtime, value.getObject(runtime), this,
+                                        getUseProxiesForUnwrapping())
+                        : nullptr;
+      if (shared != nullptr) {
+        if (existing == _properties.end()) {
+          _properties.emplace(nameString, shared);
+          changed = true;
+        } else if (existing->second != shared) {
+          existing->second = shared;
+          changed = true;
+        }
+      } else if (existing != _properties.end() &&
+                 canMergeChild(runtime, existing->second, value)) {
+        if (existing->second->mergeValue(runtime, value)) {
+          changed = true;
+        }
+      } else {
+        changed = true;
+        auto wrapped =
+            JsiWrapper::wrap(runtime, value, this, getUseProxiesForUnwrapping());
+        recordKey(nameString, wrapped.get(), recordKeys);
+        if (existing != _properties.end()) {
+          existing->second = std::move(wrapped);
+        } else {
+          _properties.emplace(nameString, std::move(wrapped));
+        }
+      }
+      names.push_back(std::move(nameString));
+    }
+
+    // Properties missing from the value are left over, erase them by walking
+    // the sorted names along the ordered properties
+    if (_properties.size() != names.size()) {
+      changed = true;
+      std::sort(names.begin(), names.end());
+      auto name = names.begin();
+      for (auto it = _properties.begin(); it != _properties.end();) {
+        while (name != names.end() && *name < it->first) {
+          name++;
+        }
+        if (name != names.end() && *name == it->first) {
+          it++;
+        } else {
+          it = _properties.erase(it);
+        }
+      }
+    }
+    return changed;
+  }
+
   void setHostObjectValue(jsi::Runtime &runtime, jsi::Object &obj) {
     setType(JsiWrapperType::HostObject);
     _hostObject = obj.asHostObject(runtime);
@@ -229,9 +445,10 @@ private:
   void setFunctionValue(jsi::Runtime &runtime, const jsi::Value &value) {
     setType(JsiWrapperType::HostFunction);
     // Check if the function is decorated as a worklet
-    if (JsiWorklet::isDecoratedAsWorklet(runtime, value)) {
+    auto worklet = JsiWorklet::fromFunction(runtime, value);
+    if (worklet->isWorklet()) {
       // Create worklet
-      auto workletInvoker = std::make_shared<WorkletInvoker>(runtime, value);
+      auto workletInvoker = std::make_shared<WorkletInvoker>(worklet);
       // Create wrapping host function
       _hostFunction =
           std::make_shared<jsi::HostFunctionType>(JSI_HOST_FUNCTION_LAMBDA {
@@ -268,5 +485,9 @@ private:
   std::shared_ptr<jsi::HostFunctionType> _hostFunction;
   std::shared_ptr<jsi::HostObject> _hostObject;
   std::shared_ptr<jsi::NativeState> _nativeState;
+  /**
+   JSON of a lazily wrapped object that has not been accessed yet
+   */
+  std::optional<std::string> _serialized;
 };
 } // namespace RNWorklet
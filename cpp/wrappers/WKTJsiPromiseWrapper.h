@@ -150,6 +150,19 @@ protected:
    */
   void setValue(jsi::Runtime &runtime, const jsi::Value &value) override;
 
+  void collectMemoryStats(JsiMemoryCounter &counter) override {
+    JsiWrapper::collectMemoryStats(counter);
+    counter.addBytes(sizeof(JsiPromiseWrapper) - sizeof(JsiWrapper) +
+                     _thenQueue.capacity() * sizeof(PromiseQueueItem) +
+                     _finallyQueue.capacity() * sizeof(FinallyQueueItem));
+    if (_value != nullptr) {
+      _value->getMemoryStats(counter);
+    }
+    if (_reason != nullptr) {
+      _reason->getMemoryStats(counter);
+    }
+  }
+
 private:
   void runComputation(jsi::Runtime &runtime,
                       PromiseComputationFunction computation);
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <memory>
+#include <string>
+
+#include <jsi/jsi.h>
+
+#include "WKTJsiWrapper.h"
+
+namespace RNWorklet {
+
+namespace jsi = facebook::jsi;
+
+/**
+ Wrapper for a reference from a wrapped object back to an object containing
+ it. The target is held weakly so that cyclic values don't keep themselves
+ alive, all other shared references hold the target wrapper directly.
+ */
+class JsiReferenceWrapper : public JsiWrapper {
+public:
+  /**
+   * Constructor
+   * @param parent Parent wrapper
+   * @param useProxiesForUnwrapping Uses proxies when unwrapping
+   * @param target The referenced wrapper
+   */
+  JsiReferenceWrapper(JsiWrapper *parent, bool useProxiesForUnwrapping,
+                      std::weak_ptr<JsiWrapper> target)
+      : JsiWrapper(parent, useProxiesForUnwrapping, JsiWrapperType::Reference),
+        _target(target) {}
+
+  /**
+   References are replaced instead of updated
+   */
+  bool canUpdateValue(jsi::Runtime &runtime, const jsi::Value &value) override {
+    return false;
+  }
+
+  /**
+   Returns the referenced wrapper, or nullptr if it has been released
+   */
+  std::shared_ptr<JsiWrapper> getTarget() { return _target.lock(); }
+
+  /**
+   Cyclic references are left out, like Array.prototype.join does
+   */
+  std::string toString(jsi::Runtime &runtime) override { return ""; }
+
+protected:
+  jsi::Value getValue(jsi::Runtime &runtime) override {
+    auto target = _target.lock();
+    if (target == nullptr) {
+      return jsi::Value::undefined();
+    }
+    return target->unwrap(runtime);
+  }
+
+  void setValue(jsi::Runtime &runtime, const jsi::Value &value) override {
+    throw jsi::JSError(runtime, "References can not be updated.");
+  }
+
+  /**
+   The target is counted where it is owned
+   */
+  void collectMemoryStats(JsiMemoryCounter &counter) override {
+    JsiWrapper::collectMemoryStats(counter);
+    counter.addBytes(sizeof(JsiReferenceWrapper) - sizeof(JsiWrapper));
+  }
+
+private:
+  std::weak_ptr<JsiWrapper> _target;
+};
+
+} // namespace RNWorklet
@@ -0,0 +1,331 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdlib>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <jsi/jsi.h>
+
+#include "WKTJsiWrapper.h"
+#include "WKTRuntimeAwareCache.h"
+
+namespace RNWorklet {
+
+namespace jsi = facebook::jsi;
+
+static const char *WorkletSerializerName = "__serializeWorkletValue";
+
+/**
+ One element of a serialized object or array. Primitives are parsed into the
+ primitive key, nested objects and arrays are kept as JSON.
+ */
+struct JsiSerializedElement {
+  /**
+   Property name, empty for array elements
+   */
+  std::string key;
+  JsiPrimitiveKey primitive;
+  /**
+   JSON of a nested object or array, empty for primitives
+   */
+  std::string json;
+
+  bool isNested() const { return !json.empty(); }
+};
+
+/**
+ Immutable JSON snapshots of plain objects and arrays. Used for lazy wrapping
+ where nested values are captured in one call to the runtime and only parsed
+ into wrappers when they are accessed.
+ */
+class JsiSerializedValue {
+public:
+  /**
+   Serializes a plain object or array to JSON in the provided runtime.
+   @param runtime Runtime of the value
+   @param value Value to serialize
+   @param json Receives the JSON
+   @return False if the value contains anything JSON can't represent exactly,
+   like functions, undefined, non-finite numbers, -0, objects referenced more
+   than once or objects with a prototype other than Object or Array. Host objects nested in the value can't
+   be detected and are serialized as plain objects.
+   */
+  static bool serialize(jsi::Runtime &runtime, const jsi::Value &value,
+                        std::string &json) {
+    if (!value.isObject()) {
+      return false;
+    }
+    auto object = value.getObject(runtime);
+    if (object.isHostObject(runtime) || object.isFunction(runtime) ||
+        object.isArrayBuffer(runtime)) {
+      return false;
+    }
+
+    auto serializer = getSerializer(runtime);
+    auto result = serializer->call(runtime, value);
+    if (!result.isString()) {
+      return false;
+    }
+    json = result.getString(runtime).utf8(runtime);
+    return true;
+  }
+
+  /**
+   Parses the top level of a JSON object or array created by serialize.
+   @param json JSON to parse
+   @return Members of the object or elements of the array in order
+   */
+  static std::vector<JsiSerializedElement> parse(const std::string &json) {
+    std::vector<JsiSerializedElement> elements;
+    size_t pos = 0;
+    skipWhitespace(json, pos);
+    if (pos >= json.size() || (json[pos] != '{' && json[pos] != '[')) {
+      return elements;
+    }
+    auto isObject = json[pos] == '{';
+    auto close = isObject ? '}' : ']';
+    pos++;
+
+    skipWhitespace(json, pos);
+    while (pos < json.size() && json[pos] != close) {
+      JsiSerializedElement element;
+      if (isObject) {
+        element.key = parseString(json, pos);
+        skipWhitespace(json, pos);
+        pos++; // ':'
+        skipWhitespace(json, pos);
+      }
+      if (json[pos] == '{' || json[pos] == '[') {
+        auto end = skipNested(json, pos);
+        element.json = json.substr(pos, end - pos);
+        pos = end;
+      } else {
+        parsePrimitive(json, pos, element.primitive);
+      }
+      elements.push_back(std::move(element));
+
+      skipWhitespace(json, pos);
+      if (pos < json.size() && json[pos] == ',') {
+        pos++;
+        skipWhitespace(json, pos);
+      }
+    }
+    return elements;
+  }
+
+private:
+  /**
+   Returns the serializer function of the runtime, creating it on first use.
+   It is kept natively instead of on the global object, so user code can't
+   replace it.
+   */
+  static std::shared_ptr<jsi::Function> getSerializer(jsi::Runtime &runtime) {
+    static auto serializers =
+        new RuntimeAwareCache<std::shared_ptr<jsi::Function>>();
+    static std::mutex mutex;
+    std::shared_ptr<jsi::Function> *entry;
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      entry = &serializers->get(runtime);
+    }
+    auto &serializer = *entry;
+    if (serializer == nullptr) {
+      static std::string code =
+          "function (value) {"
+          "  var ok = true;"
+          "  var seen = new Set();"
+          "  var replacer = function (key, v) {"
+          "    var o = this[key];"
+          "    if (typeof o === 'object' && o !== null) {"
+          "      var p = Object.getPrototypeOf(o);"
+          "      ok = ok && !seen.has(o);"
+          "      seen.add(o);"
+          "      ok = ok && (p === Object.prototype || p === Array.prototype ||"
+          "        p === null) && typeof o.toJSON !== 'function';"
+          "    } else if (typeof o === 'number') {"
+          "      ok = ok && isFinite(o) && (o !== 0 || 1 / o > 0);"
+          "    } else {"
+          "      ok = ok && (typeof o === 'string' || typeof o === 'boolean' ||"
+          "        o === null);"
+          "    }"
+          "    return ok ? v : undefined;"
+          "  };"
+          "  try {"
+          "    var json = JSON.stringify(value, replacer);"
+          "    return ok ? json : undefined;"
+          "  } catch (e) {"
+          "    return undefined;"
+          "  }"
+          "}";
+
+      auto codeBuffer =
+          std::make_shared<const jsi::StringBuffer>("(" + code + "\n)");
+      serializer = std::make_shared<jsi::Function>(
+          runtime.evaluateJavaScript(codeBuffer, WorkletSerializerName)
+              .asObject(runtime)
+              .asFunction(runtime));
+    }
+    return serializer;
+  }
+
+  static void skipWhitespace(const std::string &json, size_t &pos) {
+    while (pos < json.size() && (json[pos] == ' ' || json[pos] == '\n' ||
+                                 json[pos] == '\r' || json[pos] == '\t')) {
+      pos++;
+    }
+  }
+
+  /**
+   Returns the position after the object or array starting at pos
+   */
+  static size_t skipNested(const std::string &json, size_t pos) {
+    size_t depth = 0;
+    bool inString = false;
+    for (; pos < json.size(); pos++) {
+      auto c = json[pos];
+      if (inString) {
+        if (c == '\\') {
+          pos++;
+        } else if (c == '"') {
+          inString = false;
+        }
+      } else if (c == '"') {
+        inString = true;
+      } else if (c == '{' || c == '[') {
+        depth++;
+      } else if ((c == '}' || c == ']') && --depth == 0) {
+        return pos + 1;
+      }
+    }
+    return pos;
+  }
+
+  static void parsePrimitive(const std::string &json, size_t &pos,
+                             JsiPrimitiveKey &key) {
+    switch (json[pos]) {
+    case '"':
+      key.type = JsiWrapperType::String;
+      key.stringValue = JsiSharedString::create(parseString(json, pos));
+      break;
+    case 'n':
+      key.type = JsiWrapperType::Null;
+      pos += 4;
+      break;
+    case 't':
+      key.type = JsiWrapperType::Bool;
+      key.boolValue = true;
+      pos += 4;
+      break;
+    case 'f':
+      key.type = JsiWrapperType::Bool;
+      key.boolValue = false;
+      pos += 5;
+      break;
+    default: {
+      char *end = nullptr;
+      key.type = JsiWrapperType::Number;
+      key.numberValue = std::strtod(json.c_str() + pos, &end);
+      pos = end - json.c_str();
+      break;
+    }
+    }
+  }
+
+  /**
+   Parses the string starting at pos and returns it as UTF-8
+   */
+  static std::string parseString(const std::string &json, size_t &pos) {
+    std::string result;
+    pos++; // opening quote
+    while (pos < json.size() && json[pos] != '"') {
+      auto c = json[pos++];
+      if (c != '\\') {
+        result.push_back(c);
+        continue;
+      }
+      c = json[pos++];
+      switch (c) {
+      case 'b':
+        result.push_back('\b');
+        break;
+      case 'f':
+        result.push_back('\f');
+        break;
+      case 'n':
+        result.push_back('\n');
+        break;
+      case 'r':
+        result.push_back('\r');
+        break;
+      case 't':
+        result.push_back('\t');
+        break;
+      case 'u': {
+        uint32_t codePoint = parseHex(json, pos);
+        // Combine surrogate pairs
+        if (codePoint >= 0xD800 && codePoint <= 0xDBFF &&
+            json.compare(pos, 2, "\\u") == 0) {
+          auto next = pos + 2;
+          uint32_t low = parseHex(json, next);
+          if (low >= 0xDC00 && low <= 0xDFFF) {
+            codePoint = 0x10000 + ((codePoint - 0xD800) << 10) + (low - 0xDC00);
+            pos = next;
+          }
+        }
+        // Lone surrogates have no UTF-8 encoding, like the runtime converts
+        // them to the replacement character
+        if (codePoint >= 0xD800 && codePoint <= 0xDFFF) {
+          codePoint = 0xFFFD;
+        }
+        appendUtf8(result, codePoint);
+        break;
+      }
+      default:
+        // '"', '\\' and '/'
+        result.push_back(c);
+        break;
+      }
+    }
+    pos++; // closing quote
+    return result;
+  }
+
+  static uint32_t parseHex(const std::string &json, size_t &pos) {
+    uint32_t value = 0;
+    for (size_t i = 0; i < 4 && pos < json.size(); i++, pos++) {
+      auto c = json[pos];
+      value <<= 4;
+      if (c >= '0' && c <= '9') {
+        value |= c - '0';
+      } else if (c >= 'a' && c <= 'f') {
+        value |= c - 'a' + 10;
+      } else if (c >= 'A' && c <= 'F') {
+        value |= c - 'A' + 10;
+      }
+    }
+    return value;
+  }
+
+  static void appendUtf8(std::string &str, uint32_t codePoint) {
+    if (codePoint < 0x80) {
+      str.push_back(static_cast<char>(codePoint));
+    } else if (codePoint < 0x800) {
+      str.push_back(static_cast<char>(0xC0 | (codePoint >> 6)));
+      str.push_back(static_cast<char>(0x80 | (codePoint & 0x3F)));
+    } else if (codePoint < 0x10000) {
+      str.push_back(static_cast<char>(0xE0 | (codePoint >> 12)));
+      str.push_back(static_cast<char>(0x80 | ((codePoint >> 6) & 0x3F)));
+      str.push_back(static_cast<char>(0x80 | (codePoint & 0x3F)));
+    } else {
+      str.push_back(static_cast<char>(0xF0 | (codePoint >> 18)));
+      str.push_back(static_cast<char>(0x80 | ((codePoint >> 12) & 0x3F)));
+      str.push_back(static_cast<char>(0x80 | ((codePoint >> 6) & 0x3F)));
+      str.push_back(static_cast<char>(0x80 | (codePoint & 0x3F)));
+    }
+  }
+};
+
+} // namespace RNWorklet
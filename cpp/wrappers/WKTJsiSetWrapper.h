@@ -0,0 +1,240 @@
+#pragma once
+
+#include <jsi/jsi.h>
+
+#include <list>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "WKTJsiHostObject.h"
+#include "WKTJsiWrapSession.h"
+#include "WKTJsiWrapper.h"
+
+namespace RNWorklet {
+
+namespace jsi = facebook::jsi;
+
+/**
+ Wraps a javascript Set of primitive values. Values are stored in insertion
+ order and looked up through a hash. Shared values unwrap to a host object with
+ the Set methods, copies unwrap to a real Set.
+ */
+class JsiSetWrapper : public JsiHostObject,
+                      public std::enable_shared_from_this<JsiSetWrapper>,
+                      public JsiWrapper {
+public:
+  /**
+   * Constructor
+   * @param parent optional parent wrapper
+   * @param useProxiesForUnwrapping unwraps using proxies
+   */
+  JsiSetWrapper(JsiWrapper *parent, bool useProxiesForUnwrapping)
+      : JsiWrapper(parent, useProxiesForUnwrapping, JsiWrapperType::Set) {}
+
+  JSI_HOST_FUNCTION(add) {
+    std::unique_lock lock(_readWriteMutex);
+
+    if (addValue(getValueKey(runtime, arguments, count))) {
+      notify();
+    }
+    return jsi::Value(runtime, thisValue);
+  }
+
+  JSI_HOST_FUNCTION(has) {
+    std::unique_lock lock(_readWriteMutex);
+
+    return _index.count(getValueKey(runtime, arguments, count)) != 0;
+  }
+
+  JSI_HOST_FUNCTION(deleteImpl) {
+    std::unique_lock lock(_readWriteMutex);
+
+    auto it = _index.find(getValueKey(runtime, arguments, count));
+    if (it == _index.end()) {
+      return false;
+    }
+    _values.erase(it->second);
+    _index.erase(it);
+    notify();
+    return true;
+  }
+
+  JSI_HOST_FUNCTION(clear) {
+    std::unique_lock lock(_readWriteMutex);
+
+    if (!_values.empty()) {
+      _values.clear();
+      _index.clear();
+      notify();
+    }
+    return jsi::Value::undefined();
+  }
+
+  JSI_HOST_FUNCTION(forEach) {
+    if (count == 0 || !arguments[0].isObject() ||
+        !arguments[0].asObject(runtime).isFunction(runtime)) {
+      throw createTypeError(runtime,
+                            "Set.prototype.forEach expects a function.");
+    }
+    std::unique_lock lock(_readWriteMutex);
+
+    auto callbackFn = arguments[0].asObject(runtime).asFunction(runtime);
+    jsi::Value undefined;
+    const jsi::Value &thisArg = count > 1 ? arguments[1] : undefined;
+
+    // Iterate a snapshot so that the callback can modify the set
+    std::vector<JsiPrimitiveKey> values(_values.begin(), _values.end());
+
+    std::vector<jsi::Value> args(3);
+    args[2] = thisValue.asObject(runtime);
+    for (auto &value : values) {
+      args[0] = value.toValue(runtime);
+      args[1] = value.toValue(runtime);
+      callFunction(runtime, callbackFn, thisArg,
+                   static_cast<const jsi::Value *>(args.data()), 3);
+    }
+    return jsi::Value::undefined();
+  }
+
+  JSI_HOST_FUNCTION(values) {
+    std::unique_lock lock(_readWriteMutex);
+
+    auto result = jsi::Array(runtime, _values.size());
+    size_t i = 0;
+    for (auto &value : _values) {
+      result.setValueAtIndex(runtime, i++, value.toValue(runtime));
+    }
+    return result;
+  }
+
+  JSI_HOST_FUNCTION(toStringImpl) {
+    return jsi::String::createFromUtf8(runtime, toString(runtime));
+  }
+
+  JSI_PROPERTY_GET(size) {
+    std::unique_lock lock(_readWriteMutex);
+    return static_cast<double>(_values.size());
+  }
+
+  JSI_EXPORT_FUNCTIONS(JSI_EXPORT_FUNC(JsiSetWrapper, add),
+                       JSI_EXPORT_FUNC(JsiSetWrapper, has),
+                       JSI_EXPORT_FUNC_NAMED(JsiSetWrapper, deleteImpl,
+                                             delete),
+                       JSI_EXPORT_FUNC(JsiSetWrapper, clear),
+                       JSI_EXPORT_FUNC(JsiSetWrapper, forEach),
+                       JSI_EXPORT_FUNC(JsiSetWrapper, values),
+                       JSI_EXPORT_FUNC_NAMED(JsiSetWrapper, values, keys),
+                       JSI_EXPORT_FUNC_NAMED(JsiSetWrapper, toStringImpl,
+                                             toString))
+
+  JSI_EXPORT_PROPERTY_GETTERS(JSI_EXPORT_PROP_GET(JsiSetWrapper, size))
+
+  bool canUpdateValue(jsi::Runtime &runtime, const jsi::Value &value) override {
+    return JsiWrapSession::getCollectionType(runtime, value) ==
+           JsiWrapperType::Set;
+  }
+
+  /**
+   * Overridden setValue
+   * @param runtime Value's runtime
+   * @param value Set to set
+   */
+  void setValue(jsi::Runtime &runtime, const jsi::Value &value) override {
+    std::unique_lock lock(_readWriteMutex);
+
+    _values.clear();
+    _index.clear();
+
+    auto arrayFrom = runtime.global()
+                         .getPropertyAsObject(runtime, "Array")
+                         .getPropertyAsFunction(runtime, "from");
+    auto values =
+        arrayFrom.call(runtime, value).asObject(runtime).asArray(runtime);
+    size_t size = values.size(runtime);
+    for (size_t i = 0; i < size; i++) {
+      JsiPrimitiveKey key;
+      if (!JsiPrimitiveKey::fromValue(runtime, values.getValueAtIndex(runtime, i),
+                                      key)) {
+        throw jsi::JSError(runtime,
+                           "Sets with object values can not be shared.");
+      }
+      addValue(key);
+    }
+  }
+
+  /**
+   * Overridden getValue, returns the host object when using proxies and a
+   * copy of the set otherwise
+   * @param runtime Runtime to convert value into
+   */
+  jsi::Value getValue(jsi::Runtime &runtime) override {
+    if (getUseProxiesForUnwrapping()) {
+      return jsi::Object::createFromHostObject(runtime, shared_from_this());
+    }
+
+    std::unique_lock lock(_readWriteMutex);
+
+    auto set = runtime.global()
+                   .getPropertyAsFunction(runtime, "Set")
+                   .callAsConstructor(runtime)
+                   .asObject(runtime);
+    auto add = set.getPropertyAsFunction(runtime, "add");
+    for (auto &value : _values) {
+      add.callWithThis(runtime, set, value.toValue(runtime));
+    }
+    return set;
+  }
+
+  std::string toString(jsi::Runtime &runtime) override { return "[object Set]"; }
+
+protected:
+  void collectMemoryStats(JsiMemoryCounter &counter) override {
+    JsiWrapper::collectMemoryStats(counter);
+    counter.addBytes(sizeof(JsiSetWrapper) - sizeof(JsiWrapper) +
+                     _index.bucket_count() * sizeof(void *));
+    for (auto &value : _values) {
+      // List node and index node
+      counter.addBytes(sizeof(JsiPrimitiveKey) + 2 * sizeof(void *) +
+                       sizeof(decltype(_index)::value_type) + sizeof(void *));
+      counter.addSharedString(value.stringValue.get());
+    }
+  }
+
+private:
+  /**
+   Returns the value argument
+   */
+  JsiPrimitiveKey getValueKey(jsi::Runtime &runtime,
+                              const jsi::Value *arguments, size_t count) {
+    JsiPrimitiveKey key;
+    if (count > 0 && !JsiPrimitiveKey::fromValue(runtime, arguments[0], key)) {
+      throw jsi::JSError(runtime,
+                         "Only primitive values are supported in shared Sets.");
+    }
+    return key;
+  }
+
+  /**
+   Adds a value if it is not in the set. Caller must hold the lock.
+   @return True if the value was added
+   */
+  bool addValue(JsiPrimitiveKey key) {
+    // -0 is stored as 0 like in a javascript Set
+    key.numberValue += 0.0;
+    if (_index.count(key) != 0) {
+      return false;
+    }
+    _values.push_back(key);
+    _index.emplace(key, std::prev(_values.end()));
+    return true;
+  }
+
+  std::list<JsiPrimitiveKey> _values;
+  std::unordered_map<JsiPrimitiveKey, std::list<JsiPrimitiveKey>::iterator,
+                     JsiPrimitiveKey::Hash>
+      _index;
+};
+
+} // namespace RNWorklet
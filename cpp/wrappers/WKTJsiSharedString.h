@@ -0,0 +1,127 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <utility>
+
+#include <jsi/jsi.h>
+
+namespace RNWorklet {
+
+namespace jsi = facebook::jsi;
+
+/**
+ Immutable UTF-8 string that is shared by reference between the wrappers and
+ keys holding it, so that copying a string between wrappers never copies its
+ characters. Whether the string is ASCII is computed the first time it is
+ converted to a javascript string, and the hash the first time it is used as a
+ key, so strings that are only stored pay for neither.
+ */
+class JsiSharedString {
+public:
+  explicit JsiSharedString(std::string utf8)
+      : _utf8(std::move(utf8)) {}
+
+  JsiSharedString(const JsiSharedString &) = delete;
+  JsiSharedString &operator=(const JsiSharedString &) = delete;
+
+  /**
+   Creates a shared string from a UTF-8 string
+   */
+  static std::shared_ptr<const JsiSharedString> create(std::string utf8) {
+    return std::make_shared<const JsiSharedString>(std::move(utf8));
+  }
+
+  /**
+   Creates a shared string from a javascript string
+   @param runtime Runtime of the string
+   @param str String to copy
+   */
+  static std::shared_ptr<const JsiSharedString>
+  fromValue(jsi::Runtime &runtime, const jsi::String &str) {
+    return create(str.utf8(runtime));
+  }
+
+  /**
+   Returns the string as a javascript string in the provided runtime. ASCII
+   strings are created with createFromAscii which skips UTF-8 decoding.
+   */
+  jsi::String toValue(jsi::Runtime &runtime) const {
+    if (isAscii()) {
+      return jsi::String::createFromAscii(runtime, _utf8.data(), _utf8.size());
+    }
+    return jsi::String::createFromUtf8(
+        runtime, reinterpret_cast<const uint8_t *>(_utf8.data()),
+        _utf8.size());
+  }
+
+  /**
+   Returns the UTF-8 characters of the string
+   */
+  const std::string &str() const { return _utf8; }
+
+  bool isAscii() const {
+    auto ascii = _ascii.load(std::memory_order_relaxed);
+    if (ascii == AsciiState::Unknown) {
+      ascii = isAsciiString(_utf8) ? AsciiState::Ascii : AsciiState::NotAscii;
+      _ascii.store(ascii, std::memory_order_relaxed);
+    }
+    return ascii == AsciiState::Ascii;
+  }
+
+  size_t hash() const {
+    if (_hasHash.load(std::memory_order_acquire)) {
+      return _hash.load(std::memory_order_relaxed);
+    }
+    auto hash = std::hash<std::string>()(_utf8);
+    _hash.store(hash, std::memory_order_relaxed);
+    _hasHash.store(true, std::memory_order_release);
+    return hash;
+  }
+
+  /**
+   Returns true if the strings have the same characters. Shared instances are
+   compared by reference first.
+   */
+  static bool equals(const std::shared_ptr<const JsiSharedString> &a,
+                     const std::shared_ptr<const JsiSharedString> &b) {
+    if (a == b) {
+      return true;
+    }
+    if (a == nullptr || b == nullptr) {
+      return false;
+    }
+    // Only compare hashes that were already computed
+    if (a->_hasHash.load(std::memory_order_acquire) &&
+        b->_hasHash.load(std::memory_order_acquire) &&
+        a->_hash.load(std::memory_order_relaxed) !=
+            b->_hash.load(std::memory_order_relaxed)) {
+      return false;
+    }
+    return a->_utf8 == b->_utf8;
+  }
+
+private:
+  enum class AsciiState : uint8_t { Unknown, Ascii, NotAscii };
+
+  static bool isAsciiString(const std::string &str) {
+    for (auto c : str) {
+      if (static_cast<unsigned char>(c) >= 0x80) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  const std::string _utf8;
+  // Computed on first use. Concurrent first uses compute the same result, so
+  // racing stores are harmless.
+  mutable std::atomic<AsciiState> _ascii = {AsciiState::Unknown};
+  mutable std::atomic<size_t> _hash = {0};
+  mutable std::atomic<bool> _hasHash = {false};
+};
+
+} // namespace RNWorklet
@@ -0,0 +1,321 @@
+#pragma once
+
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <jsi/jsi.h>
+
+#include "WKTJsiNodePool.h"
+#include "WKTJsiReferenceWrapper.h"
+#include "WKTJsiWrapper.h"
+#include "WKTRuntimeAwareCache.h"
+
+namespace RNWorklet {
+
+namespace jsi = facebook::jsi;
+
+/**
+ Tracks the javascript objects wrapped in one call to JsiWrapper::wrap (or
+ updateValue), so that cyclic values terminate. A reference back to an object
+ that is still being wrapped is found by comparing it natively with the
+ objects being wrapped, which costs nothing but a few comparisons for values
+ without cycles.
+
+ Sessions that preserve references also map every wrapped object to its
+ wrapper, so that an object referenced from several places is wrapped once.
+ Objects are identified through a javascript Map in the wrapping runtime,
+ which costs two calls into the runtime per object, so this is opt-in.
+
+ Sessions are per thread. A Scope starts a session if none is active for the
+ runtime, nested wraps join the active session.
+ */
+class JsiWrapSession {
+public:
+  class Scope {
+  public:
+    /**
+     Starts a session if there is no active session for the runtime
+     @param runtime Runtime of the wrapped values
+     @param preserveReferences Wraps objects referenced from several places
+     once, used if the scope starts a session
+     */
+    explicit Scope(jsi::Runtime &runtime, bool preserveReferences = false)
+        : _previous(current()) {
+      if (_previous == nullptr || _previous->_runtime != &runtime) {
+        _session =
+            std::make_unique<JsiWrapSession>(runtime, preserveReferences);
+        current() = _session.get();
+      }
+    }
+
+    ~Scope() {
+      if (_session != nullptr) {
+        current() = _previous;
+      }
+    }
+
+    Scope(const Scope &) = delete;
+    Scope &operator=(const Scope &) = delete;
+
+  private:
+    JsiWrapSession *_previous;
+    std::unique_ptr<JsiWrapSession> _session;
+  };
+
+  JsiWrapSession(jsi::Runtime &runtime, bool preserveReferences)
+      : _runtime(&runtime), _preserveReferences(preserveReferences) {}
+
+  /**
+   Returns the active session for the runtime or nullptr
+   */
+  static JsiWrapSession *getCurrent(jsi::Runtime &runtime) {
+    auto session = current();
+    return session != nullptr && session->_runtime == &runtime ? session
+                                                                : nullptr;
+  }
+
+  /**
+   Returns true if objects referenced from several places are wrapped once
+   */
+  bool getPreserveReferences() const { return _preserveReferences; }
+
+  /**
+   Returns the wrapper of an object wrapped earlier in this session, or
+   nullptr. An object that is still being wrapped is part of a cycle and is
+   returned as a JsiReferenceWrapper owned by the provided parent. Without
+   preserved references only objects that are still being wrapped are found.
+   */
+  std::shared_ptr<JsiWrapper> find(jsi::Runtime &runtime,
+                                   const jsi::Object &object,
+                                   JsiWrapper *parent,
+                                   bool useProxiesForUnwrapping) {
+    Entry *entry = nullptr;
+    if (!_preserveReferences) {
+      // Only the objects being wrapped can be referenced again
+      for (auto it = _inProgress.rbegin(); it != _inProgress.rend(); it++) {
+        if (jsi::Object::strictEquals(runtime, it->object, object)) {
+          entry = &it->entry;
+          break;
+        }
+      }
+    } else if (_map != nullptr) {
+      auto index = _get->callWithThis(runtime, *_map, object);
+      if (index.isNumber()) {
+        entry = &_entries.at(static_cast<size_t>(index.getNumber()));
+      }
+    }
+    if (entry == nullptr) {
+      return nullptr;
+    }
+    entry->wrapper->_hasSharedReferences = true;
+    if (entry->inProgress) {
+      return makePooledShared<JsiReferenceWrapper>(
+          parent, useProxiesForUnwrapping, entry->wrapper);
+    }
+    return entry->wrapper;
+  }
+
+  /**
+   Adds a wrapper whose value is being set
+   @return Id to pass to complete
+   */
+  size_t add(jsi::Runtime &runtime, const jsi::Object &object,
+             std::shared_ptr<JsiWrapper> wrapper) {
+    if (!_preserveReferences) {
+      _inProgress.push_back(
+          {jsi::Value(runtime, object).getObject(runtime),
+           {std::move(wrapper), true}});
+      return _inProgress.size() - 1;
+    }
+    if (_map == nullptr) {
+      _map = std::make_unique<jsi::Object>(
+          getCollectionConstructors(runtime)
+              ->map.callAsConstructor(runtime)
+              .asObject(runtime));
+      _get = std::make_unique<jsi::Function>(
+          _map->getPropertyAsFunction(runtime, "get"));
+      _set = std::make_unique<jsi::Function>(
+          _map->getPropertyAsFunction(runtime, "set"));
+    }
+    auto id = _entries.size();
+    _set->callWithThis(runtime, *_map, object,
+                       jsi::Value(static_cast<double>(id)));
+    _entries.push_back({std::move(wrapper), true});
+    return id;
+  }
+
+  /**
+   Marks the wrapper added with the given id as done. Wrappers complete in
+   the reverse order they were added.
+   */
+  void complete(size_t id) {
+    if (!_preserveReferences) {
+      _inProgress.erase(_inProgress.begin() + id, _inProgress.end());
+      return;
+    }
+    _entries.at(id).inProgress = false;
+  }
+
+  /**
+   Returns JsiWrapperType::Map or JsiWrapperType::Set if the object is an
+   instance of Map or Set, otherwise JsiWrapperType::Object. Plain objects
+   are recognized by their prototype with one call, the instanceof checks
+   only run for other prototypes.
+   */
+  static JsiWrapperType getCollectionType(jsi::Runtime &runtime,
+                                          const jsi::Object &object) {
+    auto constructors = getCollectionConstructors(runtime);
+    auto prototype = constructors->getPrototypeOf.call(runtime, object);
+    if (!prototype.isObject() ||
+        jsi::Object::strictEquals(runtime, prototype.getObject(runtime),
+                                  constructors->objectPrototype)) {
+      return JsiWrapperType::Object;
+    }
+    if (object.instanceOf(runtime, constructors->map)) {
+      return JsiWrapperType::Map;
+    }
+    if (object.instanceOf(runtime, constructors->set)) {
+      return JsiWrapperType::Set;
+    }
+    return JsiWrapperType::Object;
+  }
+
+  /**
+   Returns the collection type of a value, see getCollectionType
+   */
+  static JsiWrapperType getCollectionType(jsi::Runtime &runtime,
+                                          const jsi::Value &value) {
+    if (!value.isObject()) {
+      return JsiWrapperType::Undefined;
+    }
+    return getCollectionType(runtime, value.getObject(runtime));
+  }
+
+private:
+  static JsiWrapSession *&current() {
+    thread_local JsiWrapSession *session = nullptr;
+    return session;
+  }
+
+  struct CollectionConstructors {
+    jsi::Function map;
+    jsi::Function set;
+    jsi::Function getPrototypeOf;
+    jsi::Object objectPrototype;
+  };
+
+  /**
+   Returns the Map and Set constructors and what is needed to recognize plain
+   objects in the runtime. They are looked up once per runtime, so later
+   changes to the globals don't affect wrapping.
+   */
+  static std::shared_ptr<CollectionConstructors>
+  getCollectionConstructors(jsi::Runtime &runtime) {
+    static auto constructors =
+        new RuntimeAwareCache<std::shared_ptr<CollectionConstructors>>();
+    static std::mutex mutex;
+    std::lock_guard<std::mutex> lock(mutex);
+    auto &entry = constructors->get(runtime);
+    if (entry == nullptr) {
+      auto object = runtime.global().getPropertyAsObject(runtime, "Object");
+      entry = std::make_shared<CollectionConstructors>(CollectionConstructors{
+          runtime.global().getPropertyAsFunction(runtime, "Map"),
+          runtime.global().getPropertyAsFunction(runtime, "Set"),
+          object.getPropertyAsFunction(runtime, "getPrototypeOf"),
+          object.getPropertyAsObject(runtime, "prototype")});
+    }
+    return entry;
+  }
+
+  struct Entry {
+    std::shared_ptr<JsiWrapper> wrapper;
+    bool inProgress;
+  };
+
+  struct InProgressEntry {
+    jsi::Object object;
+    Entry entry;
+  };
+
+  jsi::Runtime *_runtime;
+  bool _preserveReferences;
+  std::unique_ptr<jsi::Object> _map;
+  std::unique_ptr<jsi::Function> _get;
+  std::unique_ptr<jsi::Function> _set;
+  // Wrapped objects by their index in the map
+  std::vector<Entry> _entries;
+  // Objects being wrapped, innermost last, without preserved references
+  std::vector<InProgressEntry> _inProgress;
+};
+
+/**
+ Maps wrappers to the values created for them while copying one value into a
+ runtime, so that arrays unwrapped as copies keep shared references and
+ cycles.
+ */
+class JsiUnwrapSession {
+public:
+  class Scope {
+  public:
+    explicit Scope(jsi::Runtime &runtime) : _previous(current()) {
+      if (_previous == nullptr || _previous->_runtime != &runtime) {
+        _session = std::make_unique<JsiUnwrapSession>(runtime);
+        current() = _session.get();
+      }
+    }
+
+    ~Scope() {
+      if (_session != nullptr) {
+        current() = _previous;
+      }
+    }
+
+    Scope(const Scope &) = delete;
+    Scope &operator=(const Scope &) = delete;
+
+  private:
+    JsiUnwrapSession *_previous;
+    std::unique_ptr<JsiUnwrapSession> _session;
+  };
+
+  explicit JsiUnwrapSession(jsi::Runtime &runtime) : _runtime(&runtime) {}
+
+  /**
+   Returns the active session for the runtime or nullptr
+   */
+  static JsiUnwrapSession *getCurrent(jsi::Runtime &runtime) {
+    auto session = current();
+    return session != nullptr && session->_runtime == &runtime ? session
+                                                                : nullptr;
+  }
+
+  /**
+   Returns the value created for the wrapper or undefined
+   */
+  jsi::Value find(jsi::Runtime &runtime, JsiWrapper *wrapper) {
+    auto it = _values.find(wrapper);
+    if (it == _values.end()) {
+      return jsi::Value::undefined();
+    }
+    return jsi::Value(runtime, it->second);
+  }
+
+  void add(jsi::Runtime &runtime, JsiWrapper *wrapper,
+           const jsi::Object &object) {
+    _values.emplace(wrapper, jsi::Value(runtime, object));
+  }
+
+private:
+  static JsiUnwrapSession *&current() {
+    thread_local JsiUnwrapSession *session = nullptr;
+    return session;
+  }
+
+  jsi::Runtime *_runtime;
+  std::unordered_map<JsiWrapper *, jsi::Value> _values;
+};
+
+} // namespace RNWorklet
@@ -1,7 +1,12 @@
 #include "WKTJsiWrapper.h"
 #include "WKTJsiArrayWrapper.h"
+#include "WKTJsiMapWrapper.h"
+#include "WKTJsiNodePool.h"
 #include "WKTJsiObjectWrapper.h"
 #include "WKTJsiPromiseWrapper.h"
+#include "WKTJsiSerializedValue.h"
+#include "WKTJsiSetWrapper.h"
+#include "WKTJsiWrapSession.h"
 
 namespace RNWorklet {
 
@@ -20,7 +25,7 @@ jsi::Value JsiWrapper::getValue(jsi::Runtime &runtime) {
   case JsiWrapperType::Number:
     return jsi::Value(static_cast<double>(_numberValue));
   case JsiWrapperType::String:
-    return jsi::String::createFromUtf8(runtime, _stringValue);
+    return _stringValue->toValue(runtime);
   default:
     throw jsi::JSError(runtime, "Value type not supported.");
     return jsi::Value::undefined();
@@ -31,32 +36,103 @@ std::shared_ptr<JsiWrapper> JsiWrapper::wrap(jsi::Runtime &runtime,
                                              const jsi::Value &value,
                                              JsiWrapper *parent,
                                              bool useProxiesForUnwrapping) {
-  std::shared_ptr<JsiWrapper> retVal = nullptr;
+  return wrap(runtime, value, parent, useProxiesForUnwrapping,
+              parent != nullptr && parent->_useLazyWrapping);
+}
 
+std::shared_ptr<JsiWrapper> JsiWrapper::wrap(jsi::Runtime &runtime,
+                                             const jsi::Value &value,
+                                             JsiWrapper *parent,
+                                             bool useProxiesForUnwrapping,
+                                             bool useLazyWrapping) {
   if (value.isUndefined() || value.isNull() || value.isBool() ||
       value.isNumber() || value.isString()) {
-    retVal = std::make_shared<JsiWrapper>(parent, useProxiesForUnwrapping);
-  } else if (value.isObject()) {
-    auto obj = value.asObject(runtime);
-    if (obj.isArray(runtime)) {
-      retVal =
-          std::make_shared<JsiArrayWrapper>(parent, useProxiesForUnwrapping);
-    } else if (!obj.isHostObject(runtime) &&
-               JsiPromiseWrapper::isThenable(runtime, obj)) {
-      retVal =
-          std::make_shared<JsiPromiseWrapper>(parent, useProxiesForUnwrapping);
-    } else {
-      retVal =
-          std::make_shared<JsiObjectWrapper>(parent, useProxiesForUnwrapping);
-    }
+    auto retVal = makePooledShared<JsiWrapper>(parent, useProxiesForUnwrapping);
+    retVal->setValue(runtime, value);
+    return retVal;
   }
 
-  if (retVal == nullptr) {
+  if (!value.isObject()) {
     throw jsi::JSError(runtime, "Value type not supported.");
     return nullptr;
   }
 
+  // Cycles, and with preserved references repeated objects, share a wrapper
+  JsiWrapSession::Scope scope(runtime,
+                              parent != nullptr && parent->_preserveReferences);
+  auto session = JsiWrapSession::getCurrent(runtime);
+  auto obj = value.getObject(runtime);
+  auto existing = session->find(runtime, obj, parent, useProxiesForUnwrapping);
+  if (existing != nullptr) {
+    return existing;
+  }
+
+  // Nested objects in lazy wrappers are captured as JSON
+  if (parent != nullptr && useLazyWrapping) {
+    JsiSerializedElement element;
+    if (JsiSerializedValue::serialize(runtime, value, element.json)) {
+      auto retVal = wrapSerialized(element, parent, useProxiesForUnwrapping);
+      session->complete(session->add(runtime, obj, retVal));
+      return retVal;
+    }
+  }
+
+  std::shared_ptr<JsiWrapper> retVal = nullptr;
+  if (obj.isArray(runtime)) {
+    retVal = makePooledShared<JsiArrayWrapper>(parent, useProxiesForUnwrapping);
+  } else if (!obj.isHostObject(runtime) &&
+             JsiPromiseWrapper::isThenable(runtime, obj)) {
+    retVal =
+        std::make_shared<JsiPromiseWrapper>(parent, useProxiesForUnwrapping);
+  } else if (obj.isHostObject(runtime) || obj.isFunction(runtime)) {
+    retVal =
+        makePooledShared<JsiObjectWrapper>(parent, useProxiesForUnwrapping);
+  } else {
+    switch (JsiWrapSession::getCollectionType(runtime, obj)) {
+    case JsiWrapperType::Map:
+      retVal =
+          makePooledShared<JsiMapWrapper>(parent, useProxiesForUnwrapping);
+      break;
+    case JsiWrapperType::Set:
+      retVal =
+          makePooledShared<JsiSetWrapper>(parent, useProxiesForUnwrapping);
+      break;
+    default:
+      retVal =
+          makePooledShared<JsiObjectWrapper>(parent, useProxiesForUnwrapping);
+      break;
+    }
+  }
+
+  retVal->_useLazyWrapping = useLazyWrapping;
+  retVal->_preserveReferences = session->getPreserveReferences();
+  auto id = session->add(runtime, obj, retVal);
   retVal->setValue(runtime, value);
+  session->complete(id);
+  return retVal;
+}
+
+std::shared_ptr<JsiWrapper>
+JsiWrapper::wrapSerialized(const JsiSerializedElement &element,
+                           JsiWrapper *parent, bool useProxiesForUnwrapping) {
+  std::shared_ptr<JsiWrapper> retVal = nullptr;
+  if (!element.isNested()) {
+    retVal = makePooledShared<JsiWrapper>(parent, useProxiesForUnwrapping);
+    retVal->setPrimitiveValue(element.primitive);
+  } else if (element.json[0] == '[') {
+    auto array =
+        makePooledShared<JsiArrayWrapper>(parent, useProxiesForUnwrapping);
+    array->setSerializedValue(element.json);
+    retVal = array;
+  } else {
+    auto object =
+        makePooledShared<JsiObjectWrapper>(parent, useProxiesForUnwrapping);
+    object->setSerializedValue(element.json);
+    retVal = object;
+  }
+  retVal->_useLazyWrapping = true;
+  retVal->_preserveReferences =
+      parent != nullptr && parent->_preserveReferences;
   return retVal;
 }
 
@@ -73,18 +149,295 @@ void JsiWrapper::setValue(jsi::Runtime &runtime, const jsi::Value &value) {
     _numberValue = value.getNumber();
   } else if (value.isString()) {
     _type = JsiWrapperType::String;
-    _stringValue = value.asString(runtime).utf8(runtime);
+    _stringValue = JsiSharedString::fromValue(runtime, value.asString(runtime));
   } else {
     throw jsi::JSError(runtime, "Value type not supported.");
   }
 }
 
+void JsiWrapper::setPrimitiveValue(const JsiPrimitiveKey &key) {
+  _type = key.type;
+  switch (key.type) {
+  case JsiWrapperType::Bool:
+    _boolValue = key.boolValue;
+    break;
+  case JsiWrapperType::Number:
+    _numberValue = key.numberValue;
+    break;
+  case JsiWrapperType::String:
+    _stringValue = key.stringValue;
+    break;
+  default:
+    break;
+  }
+}
+
 void JsiWrapper::updateValue(jsi::Runtime &runtime, const jsi::Value &value) {
   std::unique_lock lock(_readWriteMutex);
+  JsiWrapSession::Scope scope(runtime, _preserveReferences);
 
-  setValue(runtime, value);
   // Notify changes
-  notify();
+  if (mergeValue(runtime, value)) {
+    notify();
+  }
+}
+
+bool JsiWrapper::mergeValue(jsi::Runtime &runtime, const jsi::Value &value) {
+  std::unique_lock lock(_readWriteMutex);
+
+  switch (_type) {
+  case JsiWrapperType::Undefined:
+    if (value.isUndefined()) {
+      return false;
+    }
+    break;
+  case JsiWrapperType::Null:
+    if (value.isNull()) {
+      return false;
+    }
+    break;
+  case JsiWrapperType::Bool:
+    if (value.isBool() && value.getBool() == _boolValue) {
+      return false;
+    }
+    break;
+  case JsiWrapperType::Number:
+    if (value.isNumber() && isSameNumber(value.getNumber(), _numberValue)) {
+      return false;
+    }
+    break;
+  case JsiWrapperType::String:
+    if (value.isString()) {
+      auto str = value.getString(runtime).utf8(runtime);
+      if (str == _stringValue->str()) {
+        return false;
+      }
+      _stringValue = JsiSharedString::create(std::move(str));
+      return true;
+    }
+    break;
+  default:
+    break;
+  }
+
+  setValue(runtime, value);
+  return true;
+}
+
+void JsiWrapper::notifyChild(const std::string &name,
+                             const std::shared_ptr<JsiWrapper> &child) {
+  if (!hasChangeListeners()) {
+    notifyChange(JsiChange());
+    return;
+  }
+  JsiPrimitiveKey key;
+  key.type = JsiWrapperType::String;
+  key.stringValue = JsiSharedString::create(name);
+  notifyChange({{key}, child});
+}
+
+void JsiWrapper::notifyChild(size_t index,
+                             const std::shared_ptr<JsiWrapper> &child) {
+  if (!hasChangeListeners()) {
+    notifyChange(JsiChange());
+    return;
+  }
+  JsiPrimitiveKey key;
+  key.type = JsiWrapperType::Number;
+  key.numberValue = static_cast<double>(index);
+  notifyChange({{key}, child});
+}
+
+void JsiWrapper::notifyChild(size_t index, double number) {
+  if (!hasChangeListeners()) {
+    notifyChange(JsiChange());
+    return;
+  }
+  // Packed elements have no wrapper, the change gets a detached copy
+  JsiPrimitiveKey value;
+  value.type = JsiWrapperType::Number;
+  value.numberValue = number;
+  auto child = makePooledShared<JsiWrapper>(nullptr, false);
+  child->setPrimitiveValue(value);
+  notifyChild(index, child);
+}
+
+void JsiWrapper::notifyChild(const JsiPrimitiveKey &key,
+                             const std::shared_ptr<JsiWrapper> &child) {
+  if (!hasChangeListeners()) {
+    notifyChange(JsiChange());
+    return;
+  }
+  notifyChange({{key}, child});
+}
+
+bool JsiWrapper::hasChangeListeners() {
+  for (auto node = this; node != nullptr; node = node->_parent) {
+    auto listeners = node->getListeners();
+    if (listeners != nullptr && !listeners->changes.empty()) {
+      return true;
+    }
+  }
+  return false;
+}
+
+void JsiWrapper::notifyChange(JsiChange change, bool notifySelf) {
+  if (!hasChangeListeners()) {
+    for (auto node = this; node != nullptr; node = node->_parent) {
+      if (node != this || notifySelf) {
+        node->_version++;
+        if (node->_batchDepth > 0) {
+          // The depth is checked again under the batch mutex, a batch ending
+          // on another thread takes its changes under the same mutex
+          std::lock_guard<std::mutex> lock(node->_batchMutex);
+          if (node->_batchDepth > 0) {
+            node->_batchChanged = true;
+            return;
+          }
+        }
+        auto listeners = node->getListeners();
+        if (listeners != nullptr) {
+          node->notifyListeners(*listeners, nullptr);
+        }
+      }
+    }
+    return;
+  }
+
+  // The key of each wrapper in its parent is resolved only when a change
+  // listener above it compares or receives the path
+  struct PathLink {
+    bool resolved = false;
+    JsiPrimitiveKey key;
+    std::shared_ptr<JsiWrapper> child;
+  };
+  std::vector<JsiWrapper *> nodes;
+  std::vector<PathLink> links;
+
+  auto resolve = [&](size_t index) -> const PathLink & {
+    auto &link = links[index];
+    if (!link.resolved) {
+      link.resolved = true;
+      // Parents record the keys of their children while there are change
+      // listeners, so the parent is not locked here. This thread holds the
+      // lock of the child and parents are locked before their children.
+      link.key = getKeyInParent(nodes[index]);
+      if (link.key.type != JsiWrapperType::Undefined) {
+        link.child = nodes[index]->getSharedSelf();
+      }
+    }
+    return link;
+  };
+
+  // Returns true if the change seen from nodes[depth] affects the path,
+  // comparing keys from the top so that a mismatch resolves as few as possible
+  auto affects = [&](size_t depth, const std::vector<JsiPrimitiveKey> &path) {
+    for (size_t i = 0; i < path.size(); i++) {
+      if (i < depth) {
+        auto &link = resolve(depth - 1 - i);
+        if (link.child == nullptr) {
+          // The key of the child is unknown, e.g. an element of a Set, so the
+          // change can't be matched with paths through it
+          return false;
+        }
+        if (!JsiChange::pathKeyEquals(link.key, path[i])) {
+          return false;
+        }
+      } else if (i - depth >= change.path.size()) {
+        return true;
+      } else if (!JsiChange::pathKeyEquals(change.path[i - depth], path[i])) {
+        return false;
+      }
+    }
+    return true;
+  };
+
+  // Change as seen from nodes[depth], extended as the walk goes up
+  auto current = change;
+  size_t currentDepth = 0;
+  auto changeAt = [&](size_t depth) -> const JsiChange & {
+    for (; currentDepth < depth; currentDepth++) {
+      auto &link = resolve(currentDepth);
+      if (link.child != nullptr) {
+        current.path.insert(current.path.begin(), link.key);
+        if (current.value == nullptr) {
+          current.value = link.child;
+        }
+      } else {
+        current.path.clear();
+        current.value = nullptr;
+      }
+    }
+    return current;
+  };
+
+  size_t depth = 0;
+  for (auto node = this; node != nullptr; node = node->_parent, depth++) {
+    nodes.push_back(node);
+    links.emplace_back();
+    if (node == this && !notifySelf) {
+      continue;
+    }
+    node->_version++;
+    if (node->_batchDepth > 0) {
+      std::lock_guard<std::mutex> lock(node->_batchMutex);
+      if (node->_batchDepth > 0) {
+        node->_batchChanged = true;
+        auto listeners = node->getListeners();
+        if (listeners != nullptr && !listeners->changes.empty()) {
+          node->_batchedChanges.push_back(changeAt(depth));
+        }
+        return;
+      }
+    }
+    auto listeners = node->getListeners();
+    if (listeners == nullptr) {
+      continue;
+    }
+    auto needsPath = false;
+    for (auto &listener : listeners->changes) {
+      if (affects(depth, listener.second.path)) {
+        needsPath = true;
+        break;
+      }
+    }
+    node->notifyListeners(*listeners, needsPath ? &changeAt(depth) : nullptr);
+  }
+}
+
+void JsiWrapper::endBatch() {
+  std::vector<JsiChange> changes;
+  {
+    std::lock_guard<std::mutex> lock(_batchMutex);
+    if (--_batchDepth > 0 || !_batchChanged) {
+      return;
+    }
+    _batchChanged = false;
+    changes.swap(_batchedChanges);
+  }
+  // Change listeners added during the batch get the wrapper as changed
+  if (changes.empty()) {
+    changes.emplace_back();
+  }
+  auto listeners = getListeners();
+  if (listeners != nullptr) {
+    for (auto &listener : listeners->plain) {
+      (*listener.second)();
+    }
+  }
+  for (auto &change : changes) {
+    if (listeners == nullptr) {
+      break;
+    }
+    for (auto &listener : listeners->changes) {
+      if (change.affects(listener.second.path)) {
+        (*listener.second.callback)(change);
+      }
+    }
+  }
+  if (_parent != nullptr) {
+    notifyChange(JsiChange(), false);
+  }
 }
 
 bool JsiWrapper::canUpdateValue(jsi::Runtime &runtime,
@@ -105,18 +458,10 @@ std::string JsiWrapper::toString(jsi::Runtime &runtime) {
     return "NULL";
   case JsiWrapperType::Bool:
     return std::to_string(_boolValue);
-  case JsiWrapperType::Number: {
-    // check if fraction is empty
-    auto fraction = _numberValue - (long)_numberValue;
-    if (fraction == 0.0) {
-      return std::to_string(static_cast<long>(_numberValue));
-    }
-    std::string str = std::to_string(_numberValue);
-    str.erase(str.find_last_not_of('0') + 1, std::string::npos);
-    return str;
-  }
+  case JsiWrapperType::Number:
+    return numberToString(_numberValue);
   case JsiWrapperType::String:
-    return _stringValue;
+    return _stringValue->str();
   case JsiWrapperType::Promise:
     return "[Promise]";
   default:
@@ -125,16 +470,185 @@ std::string JsiWrapper::toString(jsi::Runtime &runtime) {
   }
 }
 
+bool JsiPrimitiveKey::fromValue(jsi::Runtime &runtime, const jsi::Value &value,
+                                JsiPrimitiveKey &key) {
+  if (value.isUndefined()) {
+    key.type = JsiWrapperType::Undefined;
+  } else if (value.isNull()) {
+    key.type = JsiWrapperType::Null;
+  } else if (value.isBool()) {
+    key.type = JsiWrapperType::Bool;
+    key.boolValue = value.getBool();
+  } else if (value.isNumber()) {
+    key.type = JsiWrapperType::Number;
+    key.numberValue = value.getNumber();
+  } else if (value.isString()) {
+    key.type = JsiWrapperType::String;
+    key.stringValue =
+        JsiSharedString::fromValue(runtime, value.getString(runtime));
+  } else {
+    return false;
+  }
+  return true;
+}
+
+jsi::Value JsiPrimitiveKey::toValue(jsi::Runtime &runtime) const {
+  switch (type) {
+  case JsiWrapperType::Null:
+    return jsi::Value::null();
+  case JsiWrapperType::Bool:
+    return jsi::Value(boolValue);
+  case JsiWrapperType::Number:
+    return jsi::Value(numberValue);
+  case JsiWrapperType::String:
+    return stringValue->toValue(runtime);
+  default:
+    return jsi::Value::undefined();
+  }
+}
+
+bool JsiWrapper::equalsPrimitive(const JsiPrimitiveKey &key) {
+  std::unique_lock lock(_readWriteMutex);
+
+  switch (_type) {
+  case JsiWrapperType::Undefined:
+  case JsiWrapperType::Null:
+    return key.type == _type;
+  case JsiWrapperType::Bool:
+    return key.type == _type && key.boolValue == _boolValue;
+  case JsiWrapperType::Number:
+    return key.equalsNumber(_numberValue);
+  case JsiWrapperType::String:
+    return key.type == _type &&
+           JsiSharedString::equals(key.stringValue, _stringValue);
+  default:
+    return false;
+  }
+}
+
+bool JsiWrapper::getPrimitiveKey(JsiPrimitiveKey &key) {
+  std::unique_lock lock(_readWriteMutex);
+
+  switch (_type) {
+  case JsiWrapperType::Undefined:
+  case JsiWrapperType::Null:
+    break;
+  case JsiWrapperType::Bool:
+    key.boolValue = _boolValue;
+    break;
+  case JsiWrapperType::Number:
+    key.numberValue = _numberValue;
+    break;
+  case JsiWrapperType::String:
+    key.stringValue = _stringValue;
+    break;
+  default:
+    return false;
+  }
+  key.type = _type;
+  return true;
+}
+
+jsi::Value JsiWrapper::unwrapShared(jsi::Runtime &runtime) {
+  std::unique_lock lock(_readWriteMutex);
+
+  // Copies are only shared within one unwrap, since they don't follow changes
+  if (isUnwrappedAsCopy()) {
+    JsiUnwrapSession::Scope scope(runtime);
+    auto copy = JsiUnwrapSession::getCurrent(runtime)->find(runtime, this);
+    return copy.isUndefined() ? getValue(runtime) : std::move(copy);
+  }
+
+  if (_unwrapped != nullptr) {
+    auto &weakObject = _unwrapped->get(runtime);
+    if (weakObject != nullptr) {
+      auto object = weakObject->lock(runtime);
+      if (!object.isUndefined()) {
+        return object;
+      }
+    }
+  }
+  auto value = getValue(runtime);
+  if (value.isObject()) {
+    rememberUnwrapped(runtime, value.getObject(runtime));
+  }
+  return value;
+}
+
+void JsiWrapper::rememberUnwrapped(jsi::Runtime &runtime,
+                                   const jsi::Object &object) {
+  if (!_hasSharedReferences) {
+    return;
+  }
+  std::unique_lock lock(_readWriteMutex);
+
+  if (isUnwrappedAsCopy()) {
+    auto session = JsiUnwrapSession::getCurrent(runtime);
+    if (session != nullptr) {
+      session->add(runtime, this, object);
+    }
+    return;
+  }
+
+  if (_unwrapped == nullptr) {
+    _unwrapped = std::make_unique<
+        RuntimeAwareCache<std::shared_ptr<jsi::WeakObject>>>();
+  }
+  _unwrapped->get(runtime) = std::make_shared<jsi::WeakObject>(runtime, object);
+}
+
+void JsiWrapper::getMemoryStats(JsiMemoryCounter &counter) {
+  std::unique_lock lock(_readWriteMutex);
+  if (counter.visit(this)) {
+    collectMemoryStats(counter);
+  }
+}
+
+void JsiWrapper::collectMemoryStats(JsiMemoryCounter &counter) {
+  counter.addNode(sizeof(JsiWrapper));
+  if (_type == JsiWrapperType::String) {
+    counter.addSharedString(_stringValue.get());
+  }
+  // Map nodes of the listeners and the callbacks they point to
+  auto listeners = getListeners();
+  if (listeners != nullptr) {
+    counter.addBytes(sizeof(Listeners) +
+                     (listeners->plain.size() + listeners->changes.size()) *
+                         (sizeof(ChangeListener) + sizeof(size_t) +
+                          sizeof(std::function<void()>) + 3 * sizeof(void *)));
+  }
+}
+
+std::string JsiWrapper::numberToString(double value) {
+  // check if fraction is empty
+  auto fraction = value - (long)value;
+  if (fraction == 0.0) {
+    return std::to_string(static_cast<long>(value));
+  }
+  std::string str = std::to_string(value);
+  str.erase(str.find_last_not_of('0') + 1, std::string::npos);
+  return str;
+}
+
 jsi::Value JsiWrapper::callFunction(jsi::Runtime &runtime,
                                     const jsi::Function &func,
                                     const jsi::Value &thisValue,
                                     const jsi::Value *arguments, size_t count) {
   if (thisValue.isUndefined()) {
     return func.call(runtime, arguments, count);
-  } else {
+  } else if (thisValue.isObject()) {
     return func.callWithThis(runtime, thisValue.asObject(runtime), arguments,
                              count);
   }
+  std::vector<jsi::Value> args;
+  args.reserve(count + 1);
+  args.emplace_back(runtime, thisValue);
+  for (size_t i = 0; i < count; i++) {
+    args.emplace_back(runtime, arguments[i]);
+  }
+  return func.getPropertyAsFunction(runtime, "call")
+      .callWithThis(runtime, func, static_cast<const jsi::Value *>(args.data()),
+                    args.size());
 }
 
 } // namespace RNWorklet
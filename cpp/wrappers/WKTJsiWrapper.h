@@ -1,5 +1,10 @@
 #pragma once
 
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <functional>
 #include <map>
 #include <memory>
 #include <mutex>
@@ -8,6 +13,10 @@
 
 #include <jsi/jsi.h>
 
+#include "WKTJsiMemoryStats.h"
+#include "WKTJsiSharedString.h"
+#include "WKTRuntimeAwareCache.h"
+
 namespace RNWorklet {
 
 namespace jsi = facebook::jsi;
@@ -24,7 +33,125 @@ enum JsiWrapperType {
   Object,
   Promise,
   HostObject,
-  HostFunction
+  HostFunction,
+  Reference,
+  Map,
+  Set
+};
+
+/**
+ A primitive javascript value that can be compared and hashed without access
+ to a runtime. Numbers compare with SameValueZero semantics, ie. NaN equals NaN
+ and -0 equals 0.
+ */
+struct JsiPrimitiveKey {
+  JsiWrapperType type = JsiWrapperType::Undefined;
+  bool boolValue = false;
+  double numberValue = 0;
+  std::shared_ptr<const JsiSharedString> stringValue;
+
+  /**
+   Creates a key from a jsi value
+   @param runtime Runtime of the value
+   @param value Value to create key from
+   @param key Receives the key
+   @return False if the value is not a primitive
+   */
+  static bool fromValue(jsi::Runtime &runtime, const jsi::Value &value,
+                        JsiPrimitiveKey &key);
+
+  /**
+   Returns the key as a value in the provided runtime
+   */
+  jsi::Value toValue(jsi::Runtime &runtime) const;
+
+  /**
+   Returns true if the key is a number with the given value
+   */
+  bool equalsNumber(double number) const {
+    return type == JsiWrapperType::Number &&
+           (numberValue == number ||
+            (std::isnan(numberValue) && std::isnan(number)));
+  }
+
+  bool isNaN() const {
+    return type == JsiWrapperType::Number && std::isnan(numberValue);
+  }
+
+  bool operator==(const JsiPrimitiveKey &other) const {
+    switch (type) {
+    case JsiWrapperType::Bool:
+      return other.type == type && other.boolValue == boolValue;
+    case JsiWrapperType::Number:
+      return other.equalsNumber(numberValue);
+    case JsiWrapperType::String:
+      return other.type == type &&
+             JsiSharedString::equals(other.stringValue, stringValue);
+    default:
+      return other.type == type;
+    }
+  }
+
+  struct Hash {
+    size_t operator()(const JsiPrimitiveKey &key) const {
+      switch (key.type) {
+      case JsiWrapperType::Bool:
+        return std::hash<bool>()(key.boolValue);
+      case JsiWrapperType::Number:
+        // All NaNs hash the same, and 0 + -0 is 0
+        return std::isnan(key.numberValue)
+                   ? 0
+                   : std::hash<double>()(key.numberValue + 0.0);
+      case JsiWrapperType::String:
+        return key.stringValue->hash();
+      default:
+        return static_cast<size_t>(key.type);
+      }
+    }
+  };
+};
+
+struct JsiSerializedElement;
+class JsiWrapSession;
+class JsiWrapper;
+
+/**
+ A change delivered to change listeners. The path leads from the wrapper the
+ listener was added to down to the changed value. An empty path means that the
+ wrapper itself changed, in which case value is nullptr.
+ */
+struct JsiChange {
+  std::vector<JsiPrimitiveKey> path;
+  std::shared_ptr<JsiWrapper> value;
+
+  /**
+   Returns true if the change affects the value at the given path, which is
+   the case when the changed value is at, below or above the path.
+   */
+  bool affects(const std::vector<JsiPrimitiveKey> &other) const {
+    auto length = std::min(path.size(), other.size());
+    for (size_t i = 0; i < length; i++) {
+      if (!pathKeyEquals(path[i], other[i])) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  /**
+   Compares path keys, array indices also match their string form
+   */
+  static bool pathKeyEquals(const JsiPrimitiveKey &a, const JsiPrimitiveKey &b) {
+    if (a.type == JsiWrapperType::Number && b.type == JsiWrapperType::String) {
+      return pathKeyEquals(b, a);
+    }
+    if (a.type == JsiWrapperType::String && b.type == JsiWrapperType::Number) {
+      return b.numberValue >= 0 && std::floor(b.numberValue) == b.numberValue &&
+             a.stringValue->str() ==
+                 std::to_string(static_cast<uint64_t>(b.numberValue));
+    }
+    return a == b;
+  }
 };
 
 class JsiWrapper {
@@ -61,6 +188,33 @@ public:
                                           JsiWrapper *parent,
                                           bool useProxiesForUnwrapping);
 
+  /**
+   * Returns a wrapper for the a jsi value. With lazy wrapping only the top
+   * level of the value is wrapped up front. Nested plain objects and arrays
+   * are captured as JSON and wrapped when they are first accessed.
+   * @param runtime Runtime to wrap value in
+   * @param value Value to wrap
+   * @param useProxiesForUnwrapping Uses proxies when unwrapping
+   * @param useLazyWrapping Wraps nested objects lazily
+   * @return A new JsiWrapper
+   */
+  static std::shared_ptr<JsiWrapper> wrap(jsi::Runtime &runtime,
+                                          const jsi::Value &value,
+                                          JsiWrapper *parent,
+                                          bool useProxiesForUnwrapping,
+                                          bool useLazyWrapping);
+
+  /**
+   * Returns a wrapper for an element of a serialized object or array
+   * @param element Element to wrap
+   * @param parent Parent wrapper
+   * @param useProxiesForUnwrapping Uses proxies when unwrapping
+   * @return A new JsiWrapper
+   */
+  static std::shared_ptr<JsiWrapper>
+  wrapSerialized(const JsiSerializedElement &element, JsiWrapper *parent,
+                 bool useProxiesForUnwrapping);
+
   /**
    * Returns a wrapper for the a jsi value without a partner and with
    * useProxiesForUnwrapping set to false
@@ -80,22 +234,36 @@ public:
    */
   static jsi::Value unwrap(jsi::Runtime &runtime,
                            std::shared_ptr<JsiWrapper> wrapper) {
-    return wrapper->getValue(runtime);
+    return wrapper->unwrap(runtime);
   }
 
   /**
-   Non-static variant of unwrap
+   Non-static variant of unwrap. Wrappers referenced from several places
+   unwrap to the same object in a runtime.
    @param runtime Runtime
    */
-  jsi::Value unwrap(jsi::Runtime &runtime) { return this->getValue(runtime); }
+  jsi::Value unwrap(jsi::Runtime &runtime) {
+    return _hasSharedReferences ? unwrapShared(runtime) : getValue(runtime);
+  }
 
   /**
-   * Updates the value from a JS value
+   * Updates the value from a JS value. Existing child wrappers are reused and
+   * listeners are notified once if anything changed.
    * @param runtime runtime for the value
    * @param value Value to set
    */
   virtual void updateValue(jsi::Runtime &runtime, const jsi::Value &value);
 
+  /**
+   Updates the wrapper in place from a JS value accepted by canUpdateValue.
+   Child wrappers that can hold their new value are reused so that only the
+   leaves that changed are replaced. Does not notify.
+   @param runtime runtime for the value
+   @param value Value to merge
+   @return True if the wrapped value changed
+   */
+  virtual bool mergeValue(jsi::Runtime &runtime, const jsi::Value &value);
+
   /**
    Returns true if the value provided can be contained in the wrapped instance.
    */
@@ -106,19 +274,53 @@ public:
    */
   JsiWrapperType getType() { return _type; }
 
+  /**
+   Marks the wrapper as referenced from more than one place
+   */
+  void setHasSharedReferences() { _hasSharedReferences = true; }
+
   /**
    * Returns the object as a string
    */
   virtual std::string toString(jsi::Runtime &runtime);
 
+  /**
+   Returns true if this wrapper holds a primitive equal to the provided key.
+   Objects are never equal to a key.
+   */
+  bool equalsPrimitive(const JsiPrimitiveKey &key);
+
+  /**
+   Creates a key from the wrapped primitive
+   @return False if the wrapped value is not a primitive
+   */
+  bool getPrimitiveKey(JsiPrimitiveKey &key);
+
+  /**
+   Adds the memory used by the wrapper and its children to the counter.
+   Wrappers counted before by the same counter are skipped.
+   @param counter Counter to add to
+   */
+  void getMemoryStats(JsiMemoryCounter &counter);
+
+  /**
+   Returns the memory used by the wrapper and its children
+   */
+  JsiMemoryStats getMemoryStats() {
+    JsiMemoryCounter counter;
+    getMemoryStats(counter);
+    return counter.getStats();
+  }
+
   /**
    * Add listener
    * @param listener callback to notify
    * @return id of the listener - used for removing the listener
    */
   size_t addListener(std::shared_ptr<std::function<void()>> listener) {
-    auto id = _listenerId++;
-    _listeners.emplace(id, listener);
+    auto id = nextListenerId();
+    updateListeners(
+        [&](Listeners &listeners) { listeners.plain.emplace(id, listener); });
     return id;
   }
 
@@ -126,17 +328,205 @@ public:
    * Remove listener
    * @param listenerId id of listener to remove
    */
-  void removeListener(size_t listenerId) { _listeners.erase(listenerId); }
+  void removeListener(size_t listenerId) {
+    updateListeners(
+        [&](Listeners &listeners) { listeners.plain.erase(listenerId); });
+  }
+
+  /**
+   * Add a listener that receives the path of each change
+   * @param listener callback to notify
+   * @param path Only changes that affect this path are delivered, they are
+   * rejected before their full path is built. Adding the first change
+   * listener records the keys of all children.
+   * @return id of the listener - used for removing the listener
+   */
+  size_t addChangeListener(
+      std::shared_ptr<std::function<void(const JsiChange &)>> listener,
+      std::vector<JsiPrimitiveKey> path = {}) {
+    auto id = nextListenerId();
+    auto keysRecorded = hasChangeListeners();
+    updateListeners([&](Listeners &listeners) {
+      listeners.changes.emplace(id, ChangeListener{path, listener});
+    });
+    if (!keysRecorded) {
+      recordChildKeys();
+    }
+    return id;
+  }
+
+  /**
+   * Remove change listener
+   * @param listenerId id of listener to remove
+   */
+  void removeChangeListener(size_t listenerId) {
+    updateListeners(
+        [&](Listeners &listeners) { listeners.changes.erase(listenerId); });
+  }
+
+  /**
+   Moves the listeners to the root wrapper that replaced this one and notifies
+   them once of the replacement. Listener ids stay valid on the replacement.
+   @param replacement Wrapper that replaced this one
+   */
+  void moveListenersTo(JsiWrapper &replacement) {
+    auto moved = std::atomic_exchange(&_listeners,
+                                      std::shared_ptr<const Listeners>());
+    if (moved != nullptr) {
+      replacement.updateListeners([&](Listeners &listeners) {
+        listeners.plain.insert(moved->plain.begin(), moved->plain.end());
+        listeners.changes.insert(moved->changes.begin(), moved->changes.end());
+      });
+    }
+    if (replacement.hasChangeListeners()) {
+      replacement.recordChildKeys();
+    }
+    replacement.notify();
+  }
+
+  /**
+   Returns the version of the wrapper, which is incremented every time the
+   wrapper or one of its children changes. Reading it takes no lock.
+   */
+  uint64_t getVersion() const { return _version.load(); }
+
+  /**
+   Sets the version, used to continue the versions of a replaced wrapper
+   */
+  void setVersion(uint64_t version) { _version.store(version); }
+
+  /**
+   Holds the lock of a wrapper and collects the notifications of the wrapper
+   and its children while in scope. When the outermost scope ends, the lock
+   is released and listeners are notified once: plain listeners are called
+   once and change listeners receive each recorded change.
+   Only the lock of the wrapper is held, so other threads accessing children
+   directly (through a proxy read before the scope began) can see some of
+   the changes. Changes are kept when the scope ends early, there is no
+   rollback.
+   */
+  class BatchScope {
+  public:
+    explicit BatchScope(std::shared_ptr<JsiWrapper> wrapper)
+        : _wrapper(wrapper), _lock(wrapper->_readWriteMutex) {
+      _wrapper->_batchDepth++;
+    }
+
+    ~BatchScope() {
+      unlock();
+      _wrapper->endBatch();
+    }
+
+    /**
+     Releases the lock before the scope ends, changes made by other threads
+     until then are still collected
+     */
+    void unlock() {
+      if (_lock.owns_lock()) {
+        _lock.unlock();
+      }
+    }
+
+    BatchScope(const BatchScope &) = delete;
+    BatchScope &operator=(const BatchScope &) = delete;
+
+  private:
+    std::shared_ptr<JsiWrapper> _wrapper;
+    std::unique_lock<std::recursive_mutex> _lock;
+  };
 
 protected:
   /**
    * Call to notify parent that something has changed
    */
-  void notify() {
-    if (_parent != nullptr) {
-      _parent->notify();
+  void notify() { notifyChange(JsiChange()); }
+
+  /**
+   Call to notify that a property was set. Builds the change path only if
+   there are change listeners.
+   @param name Name of the property
+   @param child Wrapper of the new value
+   */
+  void notifyChild(const std::string &name,
+                   const std::shared_ptr<JsiWrapper> &child);
+
+  /**
+   Call to notify that an element was set
+   @param index Index of the element
+   @param child Wrapper of the new value
+   */
+  void notifyChild(size_t index, const std::shared_ptr<JsiWrapper> &child);
+
+  /**
+   Call to notify that an element of a packed number array was set
+   @param index Index of the element
+   @param number New value
+   */
+  void notifyChild(size_t index, double number);
+
+  /**
+   Call to notify that a value was set for a key
+   @param key Key of the value
+   @param child Wrapper of the new value
+   */
+  void notifyChild(const JsiPrimitiveKey &key,
+                   const std::shared_ptr<JsiWrapper> &child);
+
+  /**
+   Returns true if the wrapper or one of its parents has change listeners
+   */
+  bool hasChangeListeners();
+
+  /**
+   Records the keys of the children in the wrapper and its descendants, see
+   setKeyInParent. Called when a change listener is added, takes the lock of
+   each wrapper, parents before children.
+   */
+  virtual void recordChildKeys() {}
+
+  /**
+   Calls recordChildKeys on a child, children shared with another parent are
+   skipped since they are reported through that parent
+   */
+  void recordKeysBelow(JsiWrapper *child) {
+    if (child != nullptr && child->_parent == this) {
+      child->recordChildKeys();
+    }
+  }
+
+  /**
+   Returns the wrapper as a shared pointer for reporting it as the value of a
+   change, nullptr while it is destroyed. Overridden by container wrappers.
+   */
+  virtual std::shared_ptr<JsiWrapper> getSharedSelf() { return nullptr; }
+
+  /**
+   Records the key a child is stored with, which builds the path of changes
+   of the child. Called with the lock of this wrapper held while the wrapper
+   or a parent has change listeners, see hasChangeListeners. Shared children
+   keep the key in their first parent only.
+   */
+  void setKeyInParent(JsiWrapper *child, JsiPrimitiveKey key) {
+    if (child->_parent == this) {
+      std::lock_guard<std::mutex> lock(getKeyMutex(child));
+      child->_keyInParent = std::move(key);
     }
-    notifyListeners();
+  }
+
+  void setKeyInParent(JsiWrapper *child, size_t index) {
+    JsiPrimitiveKey key;
+    key.type = JsiWrapperType::Number;
+    key.numberValue = static_cast<double>(index);
+    setKeyInParent(child, std::move(key));
+  }
+
+  /**
+   Returns the key of the wrapper in its parent, with an undefined type if it
+   was not recorded
+   */
+  static JsiPrimitiveKey getKeyInParent(JsiWrapper *child) {
+    std::lock_guard<std::mutex> lock(getKeyMutex(child));
+    return child->_keyInParent;
   }
 
   /**
@@ -155,15 +545,96 @@ protected:
    */
   bool getUseProxiesForUnwrapping() { return _useProxiesForUnwrapping; }
 
+  /**
+   Returns true if nested objects are wrapped lazily
+   */
+  bool getUseLazyWrapping() { return _useLazyWrapping; }
+
+  /**
+   Returns true if objects referenced from several places in values set on
+   the wrapper are wrapped once
+   */
+  bool getPreserveReferences() { return _preserveReferences; }
+
+  /**
+   Returns true if a child can be merged with a new value in place. Children
+   referenced from several places are replaced instead, since merging would
+   change every reference.
+   @param runtime runtime for the value
+   @param child Child to merge into
+   @param value New value of the child
+   */
+  static bool canMergeChild(jsi::Runtime &runtime,
+                            const std::shared_ptr<JsiWrapper> &child,
+                            const jsi::Value &value) {
+    return !child->_hasSharedReferences &&
+           child->canUpdateValue(runtime, value);
+  }
+
+  /**
+   Sets the value from a primitive key
+   */
+  void setPrimitiveValue(const JsiPrimitiveKey &key);
+
+  /**
+   Returns true if the wrapper is referenced from more than one place
+   */
+  bool getHasSharedReferences() { return _hasSharedReferences; }
+
+  /**
+   Remembers the object a shared wrapper was unwrapped to, so that the other
+   references resolve to the same object. Arrays unwrapped as copies call this
+   before unwrapping their elements so that cycles resolve to the copy.
+   @param runtime Runtime of the object
+   @param object Object the wrapper was unwrapped to
+   */
+  void rememberUnwrapped(jsi::Runtime &runtime, const jsi::Object &object);
+
+  /**
+   Returns a number formatted the same way as a wrapped number's toString
+   */
+  static std::string numberToString(double value);
+
+  /**
+   Returns true if the two numbers are the same value, ie. NaN equals NaN and
+   -0 does not equal 0.
+   */
+  static bool isSameNumber(double a, double b) {
+    return a == b ? std::signbit(a) == std::signbit(b)
+                  : std::isnan(a) && std::isnan(b);
+  }
+
   /**
    Calls the Function and returns its value. This function will call the
-   correct overload based on the this value
+   correct overload based on the this value, primitive this values are passed
+   through Function.prototype.call.
    */
   jsi::Value callFunction(jsi::Runtime &runtime, const jsi::Function &func,
                           const jsi::Value &thisValue,
                           const jsi::Value *arguments, size_t count);
 
+  /**
+   Returns a TypeError to throw, like the built-in functions throw for
+   arguments of the wrong type
+   */
+  static jsi::JSError createTypeError(jsi::Runtime &runtime,
+                                      const std::string &message) {
+    return jsi::JSError(
+        runtime, runtime.global()
+                     .getPropertyAsFunction(runtime, "TypeError")
+                     .callAsConstructor(runtime, jsi::String::createFromUtf8(
+                                                     runtime, message)));
+  }
+
 protected:
+  /**
+   Adds the memory owned by this wrapper to the counter and visits its
+   children. Subclasses add their own size and containers on top of the base
+   wrapper. Called with the lock held.
+   @param counter Counter to add to
+   */
+  virtual void collectMemoryStats(JsiMemoryCounter &counter);
+
   /**
    * Sets the value from a JS value
    * @param runtime runtime for the value
@@ -223,27 +694,161 @@ protected:
   std::recursive_mutex _readWriteMutex;
 
 private:
+  friend class JsiWrapSession;
+
+  /**
+   Returns true if the wrapper unwraps to a copy that doesn't follow changes
+   */
+  bool isUnwrappedAsCopy() {
+    return !_useProxiesForUnwrapping &&
+           (_type == JsiWrapperType::Array || _type == JsiWrapperType::Map);
+  }
+
+  /**
+   Unwraps a wrapper with shared references, reusing the object it was
+   unwrapped to earlier in the runtime
+   */
+  jsi::Value unwrapShared(jsi::Runtime &runtime);
+
+  /**
+   Notifies the listeners of the wrapper and its parents, prepending the key
+   of each wrapper in its parent to the path of the change. Stops at the first
+   wrapper in a batch, which records the change instead.
+   @param change Change to deliver
+   @param notifySelf False to start with the listeners of the parent
+   */
+  void notifyChange(JsiChange change, bool notifySelf = true);
+
+  /**
+   Ends a batch, notifies the recorded changes when it was the outermost one
+   */
+  void endBatch();
+
+  struct ChangeListener {
+    std::vector<JsiPrimitiveKey> path;
+    std::shared_ptr<std::function<void(const JsiChange &)>> callback;
+  };
+  struct Listeners {
+    std::map<size_t, std::shared_ptr<std::function<void()>>> plain;
+    std::map<size_t, ChangeListener> changes;
+  };
+
   /**
    * Notify listeners that the value has changed
+   * @param listeners Listeners to notify, see getListeners
+   * @param change Change for the change listeners, which are only called if
+   * it affects their path. Nullptr if it affects none of them.
    */
-  void notifyListeners() {
-    for (auto listener : _listeners) {
+  void notifyListeners(const Listeners &listeners, const JsiChange *change) {
+    for (auto &listener : listeners.plain) {
       (*listener.second)();
     }
+    if (change == nullptr) {
+      return;
+    }
+    for (auto &listener : listeners.changes) {
+      if (change->affects(listener.second.path)) {
+        (*listener.second.callback)(*change);
+      }
+    }
   }
 
+  /**
+   Wrapper this wrapper was first added to. Wrappers referenced from several
+   places keep only this parent, so their changes notify the listeners above
+   the first reference and are reported with the path through it.
+   */
   JsiWrapper *_parent;
 
+  /**
+   Key the wrapper is stored with in its parent. Written by the parent and
+   read by changes of the wrapper, which hold the lock of the wrapper and can
+   not wait for the lock of the parent, so it is guarded by a key mutex.
+   */
+  JsiPrimitiveKey _keyInParent;
+
+  /**
+   Returns the mutex guarding the key of a wrapper, wrappers share a few
+   mutexes by address since the key is held only while it is copied
+   */
+  static std::mutex &getKeyMutex(const JsiWrapper *wrapper) {
+    static std::mutex mutexes[31];
+    return mutexes[(reinterpret_cast<uintptr_t>(wrapper) >> 4) % 31];
+  }
+
   JsiWrapperType _type;
 
   bool _boolValue;
   double _numberValue;
-  std::string _stringValue;
+  /**
+   Strings are immutable and shared with other wrappers and keys holding the
+   same string
+   */
+  std::shared_ptr<const JsiSharedString> _stringValue;
+
+  /**
+   Listener ids are unique across wrappers, so listeners keep their ids when
+   they are moved to another wrapper
+   */
+  static size_t nextListenerId() {
+    static std::atomic<size_t> listenerId = {1000};
+    return listenerId++;
+  }
 
-  size_t _listenerId = 1000;
-  std::map<size_t, std::shared_ptr<std::function<void()>>> _listeners;
+  /**
+   Returns the listeners, which are replaced as a whole when a listener is
+   added or removed. Writers on any thread read them without a lock, a
+   listener removed while they are notified can still be called once.
+   */
+  std::shared_ptr<const Listeners> getListeners() const {
+    return std::atomic_load(&_listeners);
+  }
+
+  /**
+   Replaces the listeners with an updated copy
+   @param update Updates the copy, may be called more than once when
+   listeners are updated concurrently
+   */
+  template <typename Update> void updateListeners(Update update) {
+    auto current = getListeners();
+    std::shared_ptr<const Listeners> next;
+    do {
+      auto copy = current != nullptr ? std::make_shared<Listeners>(*current)
+                                     : std::make_shared<Listeners>();
+      update(*copy);
+      next = copy->plain.empty() && copy->changes.empty()
+                 ? nullptr
+                 : std::shared_ptr<const Listeners>(std::move(copy));
+    } while (!std::atomic_compare_exchange_weak(&_listeners, &current, next));
+  }
+
+  std::shared_ptr<const Listeners> _listeners;
+
+  std::atomic<uint64_t> _version = {0};
+
+  /**
+   Batch state, the depth is read by children notifying from other threads
+   */
+  std::atomic<size_t> _batchDepth = {0};
+  std::mutex _batchMutex;
+  bool _batchChanged = false;
+  std::vector<JsiChange> _batchedChanges;
 
   bool _useProxiesForUnwrapping;
+  bool _useLazyWrapping = false;
+  bool _preserveReferences = false;
+
+  /**
+   Set when a second reference to the wrapper is found, which can happen
+   while other threads unwrap the wrapper
+   */
+  std::atomic<bool> _hasSharedReferences = {false};
+  /**
+   Objects that shared wrappers unwrapped to as proxies or host objects. These
+   are live views of the wrapper, so they stay valid when the value changes.
+   */
+  std::unique_ptr<RuntimeAwareCache<std::shared_ptr<jsi::WeakObject>>>
+      _unwrapped;
 };
 
 } // namespace RNWorklet
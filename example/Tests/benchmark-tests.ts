@@ -0,0 +1,181 @@
+import { Worklets } from "react-native-worklets-core";
+import { Expect, ExpectValue } from "./utils";
+
+/**
+ * Logs the throughput of a benchmark and returns it.
+ */
+const report = (name: string, operations: number, elapsedMs: number) => {
+  const perSecond = Math.round((operations / Math.max(elapsedMs, 1)) * 1000);
+  console.log(`Benchmark ${name}: ${perSecond} ops/sec (${operations} ops)`);
+  return perSecond;
+};
+
+export const benchmark_tests = {
+  array_element_reads_per_second: () => {
+    const size = 1000;
+    const rounds = 100;
+    const array = Worklets.createSharedValue(
+      Array.from({ length: size }, (_, i) => i)
+    );
+    const w = Worklets.defaultContext.createRunAsync(() => {
+      "worklet";
+      const values = array.value;
+      let sum = 0;
+      const start = performance.now();
+      for (let r = 0; r < rounds; r++) {
+        for (let i = 0; i < size; i++) {
+          sum += values[i]!;
+        }
+      }
+      const indexed = performance.now() - start;
+
+      const startAt = performance.now();
+      for (let r = 0; r < rounds; r++) {
+        for (let i = 0; i < size; i++) {
+          sum += values.at(i)!;
+        }
+      }
+      const at = performance.now() - startAt;
+      return { sum, indexed, at };
+    });
+    return Expect(w(), ({ sum, indexed, at }) => {
+      report("array[i] reads", size * rounds, indexed);
+      report("array.at(i) reads", size * rounds, at);
+      const expected = ((size * (size - 1)) / 2) * rounds * 2;
+      return sum === expected ? undefined : `sum ${expected}, got ${sum}`;
+    });
+  },
+
+  state_object_updates_per_second: () => {
+    const keys = 500;
+    const updates = 200;
+    const state: Record<string, number> = {};
+    for (let i = 0; i < keys; i++) {
+      state[`key${i}`] = i;
+    }
+    const sharedValue = Worklets.createSharedValue(state);
+    let notifications = 0;
+    const unsubscribe = sharedValue.addListener(() => notifications++, {
+      sync: true,
+    });
+    const start = performance.now();
+    for (let i = 0; i < updates; i++) {
+      state.key0 = -i - 1;
+      sharedValue.value = state;
+    }
+    const elapsed = performance.now() - start;
+    unsubscribe();
+    report("state object updates (500 keys)", updates, elapsed);
+    return ExpectValue(
+      { notifications, key0: sharedValue.value.key0 },
+      { notifications: updates, key0: -updates }
+    );
+  },
+
+  multi_field_updates_per_second: () => {
+    const updates = 2000;
+    const sharedValue = Worklets.createSharedValue({ x: 0, y: 0, z: 0 });
+    const notifications = Worklets.createSharedValue(0);
+    const w = Worklets.defaultContext.createRunAsync(() => {
+      "worklet";
+      const unsubscribe = sharedValue.addListener(
+        () => notifications.value++,
+        { sync: true }
+      );
+      const start = performance.now();
+      for (let i = 0; i < updates; i++) {
+        sharedValue.value.x = i + 1;
+        sharedValue.value.y = i + 1;
+        sharedValue.value.z = i + 1;
+      }
+      const separate = performance.now() - start;
+
+      const startBatched = performance.now();
+      for (let i = 0; i < updates; i++) {
+        sharedValue.transaction(() => {
+          sharedValue.value.x = -i - 1;
+          sharedValue.value.y = -i - 1;
+          sharedValue.value.z = -i - 1;
+        });
+      }
+      const batched = performance.now() - startBatched;
+      unsubscribe();
+      return { separate, batched, notifications: notifications.value };
+    });
+    return Expect(w(), ({ separate, batched, notifications: count }) => {
+      report("multi-field updates (3 fields)", updates, separate);
+      report("multi-field transactions (3 fields)", updates, batched);
+      const expected = updates * 3 + updates;
+      return count === expected
+        ? undefined
+        : `notifications ${expected}, got ${count}`;
+    });
+  },
+
+  wrap_large_objects_per_second: () => {
+    const properties = 10000;
+    const rounds = 20;
+    const value: Record<string, number> = {};
+    for (let i = 0; i < properties; i++) {
+      value[`key${i}`] = i;
+    }
+    const start = performance.now();
+    for (let i = 0; i < rounds; i++) {
+      Worklets.createSharedValue(value);
+    }
+    const elapsed = performance.now() - start;
+    report("wrapped nodes (10k-property objects)", properties * rounds, elapsed);
+    const stats = Worklets.createSharedValue(value).getMemoryStats();
+    return ExpectValue(stats.nodes, properties + 1);
+  },
+
+  wrap_nested_objects_with_and_without_references: () => {
+    const objects = 5000;
+    const rounds = 10;
+    const value = Array.from({ length: objects }, (_, i) => ({
+      id: i,
+      position: { x: i, y: -i },
+    }));
+    const measure = (preserveReferences: boolean) => {
+      const start = performance.now();
+      for (let i = 0; i < rounds; i++) {
+        Worklets.createSharedValue(value, { preserveReferences });
+      }
+      return performance.now() - start;
+    };
+    const nodes = objects * 5 * rounds;
+    report("wrapped nested nodes", nodes, measure(false));
+    report("wrapped nested nodes (preserveReferences)", nodes, measure(true));
+    const stats = Worklets.createSharedValue(value).getMemoryStats();
+    return ExpectValue(stats.nodes, objects * 5 + 1);
+  },
+
+  pass_large_object_arguments_per_second: () => {
+    const properties = 10000;
+    const rounds = 20;
+    const value: Record<string, number> = {};
+    for (let i = 0; i < properties; i++) {
+      value[`key${i}`] = i;
+    }
+    const w = Worklets.defaultContext.createRunAsync(
+      (arg: Record<string, number>) => {
+        "worklet";
+        return arg.key9999;
+      }
+    );
+    const run = async () => {
+      let sum = 0;
+      const start = performance.now();
+      for (let i = 0; i < rounds; i++) {
+        sum += await w(value);
+      }
+      report(
+        "argument nodes (10k-property objects)",
+        properties * rounds,
+        performance.now() - start
+      );
+      return sum;
+    };
+    return ExpectValue(run(), (properties - 1) * rounds);
+  },
+};
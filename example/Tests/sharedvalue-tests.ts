@@ -1,6 +1,21 @@
 import { Worklets } from "react-native-worklets-core";
+import type { ISharedValueChange } from "react-native-worklets-core";
 import { Expect, ExpectException, ExpectValue } from "./utils";
 
+/**
+ * Resolves after the listener deliveries scheduled so far on the JS thread
+ * have run, by scheduling one more delivery behind them.
+ */
+const afterScheduledDeliveries = () =>
+  new Promise<void>((resolve) => {
+    const marker = Worklets.createSharedValue(0);
+    const unsubscribe = marker.addListener(() => {
+      unsubscribe();
+      resolve();
+    });
+    marker.value = 1;
+  });
+
 export const sharedvalue_tests = {
   get_set_numeric_value: () => {
     const sharedValue = Worklets.createSharedValue(100);
@@ -166,21 +181,502 @@ export const sharedvalue_tests = {
   },
 
   add_listener: () => {
+    const sharedValue = Worklets.createSharedValue(100);
+    const didChange = new Promise<boolean>((resolve) => {
+      const unsubscribe = sharedValue.addListener(() => {
+        unsubscribe();
+        resolve(true);
+      });
+    });
+    sharedValue.value = 50;
+    return ExpectValue(didChange, true);
+  },
+
+  add_listener_sync: () => {
     const sharedValue = Worklets.createSharedValue(100);
     const didChange = Worklets.createSharedValue(false);
-    const unsubscribe = sharedValue.addListener(() => (didChange.value = true));
+    const unsubscribe = sharedValue.addListener(
+      () => (didChange.value = true),
+      { sync: true }
+    );
     sharedValue.value = 50;
     unsubscribe();
     return ExpectValue(didChange.value, true);
   },
 
+  add_listener_coalesces_changes: () => {
+    const sharedValue = Worklets.createSharedValue([0, 0, 0]);
+    let notifications = 0;
+    const unsubscribe = sharedValue.addListener(() => notifications++);
+    for (let i = 0; i < 100; i++) {
+      sharedValue.value[i % 3] = i;
+    }
+    const delivered = afterScheduledDeliveries().then(() => {
+      unsubscribe();
+      return notifications;
+    });
+    return ExpectValue(delivered, 1);
+  },
+
+  removed_listener_is_not_called: () => {
+    const sharedValue = Worklets.createSharedValue(100);
+    let notifications = 0;
+    const unsubscribe = sharedValue.addListener(() => notifications++);
+    sharedValue.value = 50;
+    unsubscribe();
+    const delivered = afterScheduledDeliveries().then(() => notifications);
+    return ExpectValue(delivered, 0);
+  },
+
+  add_listener_changes_include_path: () => {
+    const sharedValue = Worklets.createSharedValue({ items: [{ x: 1 }] });
+    let changes: ISharedValueChange[] = [];
+    const unsubscribe = sharedValue.addListener((c) => (changes = c), {
+      changes: true,
+      sync: true,
+    });
+    sharedValue.value.items[0].x = 5;
+    unsubscribe();
+    return ExpectValue(changes, [{ path: ["items", 0, "x"], value: 5 }]);
+  },
+
+  add_listener_changes_include_path_after_elements_moved: () => {
+    const sharedValue = Worklets.createSharedValue({
+      items: [{ x: 1 }, { x: 2 }],
+    });
+    let changes: ISharedValueChange[] = [];
+    const unsubscribe = sharedValue.addListener((c) => (changes = c), {
+      changes: true,
+      sync: true,
+    });
+    sharedValue.value.items.unshift({ x: 0 });
+    sharedValue.value.items[2].x = 5;
+    unsubscribe();
+    return ExpectValue(changes, [{ path: ["items", 2, "x"], value: 5 }]);
+  },
+
+  listeners_survive_value_replacement: () => {
+    const sharedValue = Worklets.createSharedValue<unknown>({ a: 1 });
+    const changes: string[] = [];
+    const unsubscribe = sharedValue.addListener(
+      (c) => c.forEach((change) => changes.push(JSON.stringify(change))),
+      { changes: true, sync: true }
+    );
+    sharedValue.value = null;
+    sharedValue.value = [1];
+    (sharedValue.value as number[])[0] = 2;
+    unsubscribe();
+    sharedValue.value = 3;
+    return ExpectValue(changes, [
+      JSON.stringify({ path: [], value: null }),
+      JSON.stringify({ path: [], value: [1] }),
+      JSON.stringify({ path: [0], value: 2 }),
+    ]);
+  },
+
+  add_listener_changes_include_path_of_added_values: () => {
+    const sharedValue = Worklets.createSharedValue({
+      items: [] as { x: number }[],
+    });
+    let changes: ISharedValueChange[] = [];
+    const unsubscribe = sharedValue.addListener((c) => (changes = c), {
+      changes: true,
+      sync: true,
+    });
+    sharedValue.value.items.push({ x: 1 }, { x: 2 });
+    sharedValue.value.items.reverse();
+    sharedValue.value.items[0].x = 3;
+    unsubscribe();
+    return ExpectValue(changes, [{ path: ["items", 0, "x"], value: 3 }]);
+  },
+
+  add_listener_coalesces_changes_with_paths: () => {
+    const sharedValue = Worklets.createSharedValue({ a: 1, b: 2 });
+    const delivered = new Promise<ISharedValueChange[]>((resolve) => {
+      const unsubscribe = sharedValue.addListener(
+        (changes) => {
+          unsubscribe();
+          resolve(changes);
+        },
+        { changes: true }
+      );
+      sharedValue.value.a = 3;
+      sharedValue.value.b = 4;
+    });
+    return ExpectValue(delivered, [
+      { path: ["a"], value: 3 },
+      { path: ["b"], value: 4 },
+    ]);
+  },
+
+  add_listener_with_path_ignores_other_properties: () => {
+    const sharedValue = Worklets.createSharedValue({ cursor: 0, history: [0] });
+    let notifications = 0;
+    const unsubscribe = sharedValue.addListener(() => notifications++, {
+      path: "cursor",
+      sync: true,
+    });
+    sharedValue.value.history.push(1);
+    sharedValue.value.history[0] = 2;
+    sharedValue.value.cursor = 1;
+    unsubscribe();
+    return ExpectValue(notifications, 1);
+  },
+
+  add_listener_with_path_into_array: () => {
+    const sharedValue = Worklets.createSharedValue({ items: [{ x: 1 }, { x: 2 }] });
+    let notifications = 0;
+    const unsubscribe = sharedValue.addListener(() => notifications++, {
+      path: ["items", 1],
+      sync: true,
+    });
+    sharedValue.value.items[0].x = 3;
+    sharedValue.value.items[1].x = 4;
+    unsubscribe();
+    return ExpectValue(notifications, 1);
+  },
+
+  transaction_notifies_once: () => {
+    const sharedValue = Worklets.createSharedValue({ x: 0, y: 0, z: 0 });
+    let notifications = 0;
+    const unsubscribe = sharedValue.addListener(() => notifications++, {
+      sync: true,
+    });
+    sharedValue.transaction(() => {
+      sharedValue.value.x = 1;
+      sharedValue.value.y = 2;
+      sharedValue.value.z = 3;
+    });
+    unsubscribe();
+    return ExpectValue(notifications, 1);
+  },
+
+  transaction_delivers_all_changes: () => {
+    const sharedValue = Worklets.createSharedValue({ x: 0, y: 0 });
+    let changes: ISharedValueChange[] = [];
+    const unsubscribe = sharedValue.addListener(
+      (c) => (changes = changes.concat(c)),
+      { changes: true, sync: true }
+    );
+    const result = sharedValue.transaction(() => {
+      sharedValue.value.x = 1;
+      sharedValue.value.y = 2;
+      return "done";
+    });
+    unsubscribe();
+    return ExpectValue({ result, changes }, {
+      result: "done",
+      changes: [
+        { path: ["x"], value: 1 },
+        { path: ["y"], value: 2 },
+      ],
+    });
+  },
+
+  transaction_keeps_changes_when_throwing: () => {
+    const sharedValue = Worklets.createSharedValue({ x: 0, y: 0 });
+    let notifications = 0;
+    const unsubscribe = sharedValue.addListener(() => notifications++, {
+      sync: true,
+    });
+    try {
+      sharedValue.transaction(() => {
+        sharedValue.value.x = 1;
+        throw new Error("Test error");
+      });
+    } catch {}
+    unsubscribe();
+    return ExpectValue(
+      { x: sharedValue.value.x, y: sharedValue.value.y, notifications },
+      { x: 1, y: 0, notifications: 1 }
+    );
+  },
+
+  transaction_does_not_lock_nested_proxies: () => {
+    const sharedValue = Worklets.createSharedValue({ pos: { x: 0, y: 0 } });
+    const reached = Worklets.createSharedValue(false);
+    const release = Worklets.createSharedValue(false);
+    // Read before the transaction, reads through it only lock the nested value
+    const pos = sharedValue.value.pos;
+    const w = Worklets.defaultContext.createRunAsync(function () {
+      "worklet";
+      sharedValue.transaction(() => {
+        sharedValue.value.pos.x = 1;
+        reached.value = true;
+        while (!release.value) {}
+        sharedValue.value.pos.y = 1;
+      });
+    });
+    const done = w();
+    const seen = (async () => {
+      while (!reached.value) {
+        await new Promise((resolve) => setTimeout(resolve, 1));
+      }
+      const result = { x: pos.x, y: pos.y };
+      release.value = true;
+      await done;
+      return result;
+    })();
+    return ExpectValue(seen, { x: 1, y: 0 });
+  },
+
+  batch_in_worklet_notifies_once_per_value: () => {
+    const a = Worklets.createSharedValue({ x: 0, y: 0 });
+    const b = Worklets.createSharedValue([0, 0]);
+    const notifications = Worklets.createSharedValue(0);
+    const w = Worklets.defaultContext.createRunAsync(function () {
+      "worklet";
+      const unsubscribeA = a.addListener(() => notifications.value++, {
+        sync: true,
+      });
+      const unsubscribeB = b.addListener(() => notifications.value++, {
+        sync: true,
+      });
+      Worklets.batch([a, b], () => {
+        a.value.x = 1;
+        a.value.y = 2;
+        b.value[0] = 1;
+        b.value[1] = 2;
+      });
+      unsubscribeA();
+      unsubscribeB();
+      return notifications.value;
+    });
+    return ExpectValue(w(), 2);
+  },
+
+  version_increases_on_change: () => {
+    const sharedValue = Worklets.createSharedValue({ a: { b: 1 } });
+    const initial = sharedValue.version;
+    sharedValue.value.a.b = 1;
+    const unchanged = sharedValue.version;
+    sharedValue.value.a.b = 2;
+    const nested = sharedValue.version;
+    sharedValue.value = [1, 2];
+    const replaced = sharedValue.version;
+    return ExpectValue(
+      [unchanged === initial, nested > unchanged, replaced > nested],
+      [true, true, true]
+    );
+  },
+
+  value_if_changed: () => {
+    const sharedValue = Worklets.createSharedValue(1);
+    const version = sharedValue.version;
+    const before = sharedValue.valueIfChanged(version);
+    sharedValue.value = 2;
+    const after = sharedValue.valueIfChanged(version);
+    const again = sharedValue.valueIfChanged(after!.version);
+    return ExpectValue(
+      [before, after, again],
+      [undefined, { value: 2, version: version + 1 }, undefined]
+    );
+  },
+
+  channel_try_send_and_receive: () => {
+    const channel = Worklets.createChannel<number>({ capacity: 2 });
+    const sent = [channel.trySend(1), channel.trySend(2), channel.trySend(3)];
+    const received = [channel.tryReceive(), channel.tryReceive()];
+    return ExpectValue(
+      { sent, received, empty: channel.tryReceive() },
+      { sent: [true, true, false], received: [1, 2], empty: undefined }
+    );
+  },
+
+  channel_rejects_invalid_capacity: () => {
+    const rejected = [0, NaN, Infinity, 2 ** 21].map((capacity) => {
+      try {
+        Worklets.createChannel({ capacity });
+        return false;
+      } catch {
+        return true;
+      }
+    });
+    return ExpectValue(rejected, [true, true, true, true]);
+  },
+
+  channel_drain: () => {
+    const channel = Worklets.createChannel<{ i: number }>({ capacity: 8 });
+    for (let i = 0; i < 5; i++) {
+      channel.trySend({ i });
+    }
+    return ExpectValue(
+      [channel.drain(3), channel.drain()],
+      [[{ i: 0 }, { i: 1 }, { i: 2 }], [{ i: 3 }, { i: 4 }]]
+    );
+  },
+
+  channel_drain_clamps_count: () => {
+    const channel = Worklets.createChannel<number>({ capacity: 4 });
+    [1, 2, 3].forEach((i) => channel.trySend(i));
+    return ExpectValue(
+      [channel.drain(NaN), channel.drain(-1), channel.drain(Infinity)],
+      [[], [], [1, 2, 3]]
+    );
+  },
+
+  channel_streams_from_worklet: () => {
+    const count = 100;
+    const channel = Worklets.createChannel<number>({ capacity: 4 });
+    const producer = Worklets.defaultContext.createRunAsync(() => {
+      "worklet";
+      const sendFrom = (i: number) => {
+        if (i < count) {
+          channel.send(i).then(() => sendFrom(i + 1));
+        }
+      };
+      sendFrom(0);
+    });
+    producer();
+    const received = (async () => {
+      let sum = 0;
+      for (let i = 0; i < count; i++) {
+        sum += await channel.receive();
+      }
+      return sum;
+    })();
+    return ExpectValue(received, (count * (count - 1)) / 2);
+  },
+
+  triple_buffer_reads_latest_value: () => {
+    const buffer = Worklets.createTripleBuffer({ frame: 0 });
+    const initial = buffer.read();
+    buffer.publish({ frame: 1 });
+    buffer.publish({ frame: 2 });
+    return ExpectValue(
+      [initial, buffer.read(), buffer.read(), buffer.version],
+      [{ frame: 0 }, { frame: 2 }, { frame: 2 }, 2]
+    );
+  },
+
+  triple_buffer_reuses_buffers_for_changing_values: () => {
+    const buffer = Worklets.createTripleBuffer<unknown>({ frame: 0 });
+    const values: unknown[] = [
+      { frame: 1 },
+      { frame: 2, extra: [1] },
+      5,
+      { frame: 3 },
+      { frame: 4, extra: [2] },
+      { frame: 5 },
+    ];
+    const read = values.map((value) => {
+      buffer.publish(value);
+      return buffer.read();
+    });
+    return ExpectValue(read, values);
+  },
+
+  triple_buffer_published_from_worklet: () => {
+    const buffer = Worklets.createTripleBuffer({ points: [0, 0] });
+    const w = Worklets.defaultContext.createRunAsync(() => {
+      "worklet";
+      for (let i = 1; i <= 100; i++) {
+        buffer.publish({ points: [i, i * 2] });
+      }
+    });
+    return ExpectValue(
+      w().then(() => buffer.read()),
+      { points: [100, 200] }
+    );
+  },
+
+  derived_value_recomputes_on_change: () => {
+    const points = Worklets.createSharedValue([1, 5, 3]);
+    const computations = Worklets.createSharedValue(0);
+    const max = Worklets.createDerivedValue(() => {
+      "worklet";
+      computations.value++;
+      return Math.max(...points.value);
+    }, [points]);
+    const first = [max.value, max.value];
+    points.value[1] = 2;
+    const second = max.value;
+    return ExpectValue(
+      { first, second, computations: computations.value },
+      { first: [5, 5], second: 3, computations: 2 }
+    );
+  },
+
+  derived_value_computes_in_context: () => {
+    const value = Worklets.createSharedValue(2);
+    const derived = Worklets.createDerivedValue(
+      () => {
+        "worklet";
+        return { double: value.value * 2, thread: Worklets.getCurrentThreadId() };
+      },
+      [value],
+      Worklets.defaultContext
+    );
+    const w = Worklets.defaultContext.createRunAsync(() => {
+      "worklet";
+      return Worklets.getCurrentThreadId();
+    });
+    return ExpectValue(
+      w().then((thread) => derived.value.thread === thread && derived.value.double),
+      4
+    );
+  },
+
+  derived_value_read_from_js_and_context: () => {
+    const value = Worklets.createSharedValue(1);
+    const derived = Worklets.createDerivedValue(
+      () => {
+        "worklet";
+        return value.value * 10;
+      },
+      [value],
+      Worklets.defaultContext
+    );
+    const reader = Worklets.defaultContext.createRunAsync(() => {
+      "worklet";
+      let sum = 0;
+      for (let i = 1; i <= 10; i++) {
+        value.value = i;
+        sum += derived.value;
+      }
+      return sum;
+    });
+    // The read from the JS thread waits while the reader computes inline
+    const fromContext = reader();
+    const fromJs = derived.value;
+    return ExpectValue(
+      fromContext.then((sum) => [sum, fromJs % 10, derived.value]),
+      [550, 0, 100]
+    );
+  },
+
+  derived_value_returns_last_value_while_recomputing: () => {
+    const value = Worklets.createSharedValue(1);
+    const derived = Worklets.createDerivedValue(
+      () => {
+        "worklet";
+        return value.value * 10;
+      },
+      [value],
+      Worklets.defaultContext
+    );
+    const first = derived.value;
+    value.value = 2;
+    // Schedules the recomputation behind the work already queued in the context
+    const whileRecomputing = derived.value;
+    const w = Worklets.defaultContext.createRunAsync(() => {
+      "worklet";
+      return 0;
+    });
+    return ExpectValue(
+      w().then(() => [first, whileRecomputing, derived.value]),
+      [10, 10, 20]
+    );
+  },
+
   add_listener_from_worklet: () => {
     const sharedValue = Worklets.createSharedValue(100);
     const didChange = Worklets.createSharedValue(false);
     const w = Worklets.defaultContext.createRunAsync(function () {
       "worklet";
       const unsubscribe = sharedValue.addListener(
-        () => (didChange.value = true)
+        () => (didChange.value = true),
+        { sync: true }
       );
       sharedValue.value = 50;
       unsubscribe();
@@ -189,10 +685,232 @@ export const sharedvalue_tests = {
     return ExpectValue(w(), true);
   },
 
+  reassign_object_updates_existing_properties: () => {
+    const sharedValue = Worklets.createSharedValue({ a: { b: 1 }, c: 2 });
+    const a = sharedValue.value.a;
+    sharedValue.value = { a: { b: 5 }, c: 2 };
+    return ExpectValue(a.b, 5);
+  },
+
+  reassign_object_removes_and_adds_properties: () => {
+    const sharedValue = Worklets.createSharedValue<Record<string, unknown>>({
+      a: 1,
+      b: [1, 2],
+    });
+    sharedValue.value = { b: [1, "2", 3], c: { d: 4 } };
+    return ExpectValue(sharedValue.value, { b: [1, "2", 3], c: { d: 4 } });
+  },
+
+  reassign_array_after_fill_updates_each_element: () => {
+    const sharedValue = Worklets.createSharedValue(["a", "b", "c"]);
+    sharedValue.value.fill("x");
+    sharedValue.value = ["p", "q", "r"];
+    return ExpectValue(sharedValue.value, ["p", "q", "r"]);
+  },
+
+  reassign_object_does_not_merge_into_shared_references: () => {
+    const p = { x: 0 };
+    const sharedValue = Worklets.createSharedValue(
+      { a: p, b: p },
+      { preserveReferences: true }
+    );
+    sharedValue.value = { a: { x: 1 }, b: { x: 2 } };
+    return ExpectValue([sharedValue.value.a.x, sharedValue.value.b.x], [1, 2]);
+  },
+
+  reassign_object_notifies_once_when_changed: () => {
+    const state = { a: 1, b: { c: 2, d: [1, 2, 3] } };
+    const sharedValue = Worklets.createSharedValue(state);
+    let notifications = 0;
+    const unsubscribe = sharedValue.addListener(() => notifications++, {
+      sync: true,
+    });
+    sharedValue.value = { a: 1, b: { c: 2, d: [1, 2, 3] } };
+    const unchanged = notifications;
+    sharedValue.value = { a: 1, b: { c: 3, d: [1, 2, 4] } };
+    unsubscribe();
+    return ExpectValue(
+      { unchanged, changed: notifications },
+      { unchanged: 0, changed: 1 }
+    );
+  },
+
+  lazy_object_reads_nested_values: () => {
+    const sharedValue = Worklets.createSharedValue(
+      {
+        a: { b: { c: [1, 2, 3] }, d: "\u00e5\ud83d\ude00\"\n" },
+        e: [{ f: null }, true, -1.5e-7],
+      },
+      { lazy: true }
+    );
+    return ExpectValue(sharedValue.value, {
+      a: { b: { c: [1, 2, 3] }, d: "\u00e5\ud83d\ude00\"\n" },
+      e: [{ f: null }, true, -1.5e-7],
+    });
+  },
+
+  lazy_object_replaces_lone_surrogates: () => {
+    const sharedValue = Worklets.createSharedValue(
+      { a: { b: "x\ud800y", c: "\udc00" } },
+      { lazy: true }
+    );
+    return ExpectValue(sharedValue.value, {
+      a: { b: "x\ufffdy", c: "\ufffd" },
+    });
+  },
+
+  lazy_object_nested_values_are_writable: () => {
+    const sharedValue = Worklets.createSharedValue(
+      { a: { b: 1 }, c: [{ d: 2 }] },
+      { lazy: true }
+    );
+    const w = Worklets.defaultContext.createRunAsync(() => {
+      "worklet";
+      sharedValue.value.a.b = 10;
+      sharedValue.value.c[0]!.d = 20;
+    });
+    return w().then(() =>
+      ExpectValue(sharedValue.value, { a: { b: 10 }, c: [{ d: 20 }] })
+    );
+  },
+
+  lazy_object_keeps_values_json_cannot_represent: () => {
+    const sharedValue = Worklets.createSharedValue<Record<string, unknown>>(
+      { a: { b: undefined, c: NaN, d: -0 } },
+      { lazy: true }
+    );
+    const a = sharedValue.value.a as Record<string, number>;
+    return ExpectValue(
+      [Object.keys(a).includes("b"), Number.isNaN(a.c), Object.is(a.d, -0)],
+      [true, true, true]
+    );
+  },
+
+  lazy_arguments: () => {
+    const w = Worklets.defaultContext.createRunAsync(
+      (config: { a: { b: number[] }; c: string }) => {
+        "worklet";
+        return config.a.b[1]! + config.c;
+      },
+      { lazyArguments: true }
+    );
+    return ExpectValue(w({ a: { b: [1, 2] }, c: "x" }), "2x");
+  },
+
+  shared_references_share_one_value: () => {
+    const shared = { n: 1 };
+    const sharedValue = Worklets.createSharedValue(
+      { a: shared, b: shared },
+      { preserveReferences: true }
+    );
+    sharedValue.value.a.n = 5;
+    return ExpectValue(
+      [sharedValue.value.b.n, sharedValue.value.a === sharedValue.value.b],
+      [5, true]
+    );
+  },
+
+  shared_references_are_copied_by_default: () => {
+    const shared = { n: 1 };
+    const sharedValue = Worklets.createSharedValue({ a: shared, b: shared });
+    sharedValue.value.a.n = 5;
+    return ExpectValue(sharedValue.value.b.n, 1);
+  },
+
+  shared_reference_changes_use_the_first_path: () => {
+    const shared = { n: 1 };
+    const sharedValue = Worklets.createSharedValue(
+      { a: { shared }, b: { shared } },
+      { preserveReferences: true }
+    );
+    let changes: ISharedValueChange[] = [];
+    const unsubscribe = sharedValue.addListener((c) => (changes = c), {
+      changes: true,
+      sync: true,
+    });
+    sharedValue.value.b.shared.n = 2;
+    unsubscribe();
+    return ExpectValue(changes, [{ path: ["a", "shared", "n"], value: 2 }]);
+  },
+
+  cyclic_object_value: () => {
+    const value: { name: string; self?: unknown } = { name: "cycle" };
+    value.self = value;
+    const sharedValue = Worklets.createSharedValue(value);
+    const self = sharedValue.value.self as typeof value;
+    return ExpectValue(
+      [(self.self as typeof value).name, self === sharedValue.value],
+      ["cycle", true]
+    );
+  },
+
+  cyclic_array_argument: () => {
+    const array: unknown[] = [1];
+    array.push(array);
+    const w = Worklets.defaultContext.createRunAsync((a: unknown[]) => {
+      "worklet";
+      return [a[1] === a, (a[1] as unknown[])[0]];
+    });
+    return ExpectValue(w(array), [true, 1]);
+  },
+
   set_object_property_to_undefined_after_being_an_object: () => {
     const sharedValue = Worklets.createSharedValue({ a: { b: 200 } });
     // @ts-ignore
     sharedValue.value.a = undefined;
     return ExpectValue(sharedValue.value, { a: undefined });
   },
+
+  memory_stats_grow_with_value: () => {
+    const small = Worklets.createSharedValue({ a: 1 }).getMemoryStats();
+    const large = Worklets.createSharedValue({
+      a: 1,
+      b: ["x".repeat(1000), { c: 2 }],
+    }).getMemoryStats();
+    return ExpectValue(
+      [large.nodes - small.nodes, large.bytes > small.bytes + 1000],
+      [4, true]
+    );
+  },
+
+  memory_stats_include_shared_values: () => {
+    const sharedValue = Worklets.createSharedValue([1, 2, 3]);
+    const stats = Worklets.getMemoryStats();
+    return ExpectValue(
+      stats.sharedValues.count > 0 &&
+        stats.bytes >= sharedValue.getMemoryStats().bytes &&
+        stats.contexts.length > 0,
+      true
+    );
+  },
+
+  memory_stats_count_closures_when_enabled: () => {
+    const captured = { values: [1, 2, 3] };
+    const create = () =>
+      Worklets.defaultContext.createRunAsync(() => {
+        "worklet";
+        return captured.values.length;
+      });
+    const closureNodes = () =>
+      Worklets.getMemoryStats().contexts.reduce(
+        (nodes, context) => nodes + context.closures.nodes,
+        0
+      );
+    const before = closureNodes();
+    const untracked = create();
+    const afterUntracked = closureNodes();
+    Worklets.setMemoryStatsEnabled(true);
+    const tracked = create();
+    const afterTracked = closureNodes();
+    Worklets.setMemoryStatsEnabled(false);
+    return ExpectValue(
+      [
+        afterUntracked === before,
+        afterTracked > afterUntracked,
+        typeof untracked,
+        typeof tracked,
+      ],
+      [true, true, "function", "function"]
+    );
+  },
 };
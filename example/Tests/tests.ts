@@ -2,6 +2,7 @@ import { worklet_tests } from "./worklet-tests";
 import { sharedvalue_tests } from "./sharedvalue-tests";
 import { wrapper_tests } from "./wrapper-tests";
 import { worklet_context_tests } from "./worklet-context-tests";
+import { benchmark_tests } from "./benchmark-tests";
 
 export const Tests: { [key: string]: { [key: string]: () => Promise<void> } } =
   {
@@ -9,4 +10,5 @@ export const Tests: { [key: string]: { [key: string]: () => Promise<void> } } =
     Contexts: { ...worklet_context_tests },
     SharedValues: { ...sharedvalue_tests },
     WrapperTests: { ...wrapper_tests },
+    Benchmarks: { ...benchmark_tests },
   };
@@ -412,4 +412,92 @@ export const worklet_context_tests = {
     });
     return ExpectValue(result, 1200);
   },
+  recreated_worklet_reuses_evaluated_function: () => {
+    const run = (value: number) =>
+      Worklets.defaultContext.runAsync(() => {
+        "worklet";
+        return value * 2;
+      });
+    const result = run(1).then(() => {
+      const before = Worklets.getWorkletCacheStats();
+      return run(2).then((value) => {
+        const after = Worklets.getWorkletCacheStats();
+        return { value, hit: after.hits > before.hits };
+      });
+    });
+    return ExpectValue(result, { value: 4, hit: true });
+  },
+  worklet_code_is_compiled_once_for_all_contexts: () => {
+    const context = Worklets.createContext("prepared-script-context");
+    const before = Worklets.getWorkletCacheStats().prepared;
+    const f = () => {
+      "worklet";
+      return 42;
+    };
+    const result = Worklets.defaultContext
+      .runAsync(f)
+      .then(() => context.runAsync(f))
+      .then((value) => {
+        const after = Worklets.getWorkletCacheStats().prepared;
+        // Engines without shared bytecode evaluate from source
+        const isHermes = "HermesInternal" in globalThis;
+        return { value, hit: !isHermes || after.hits > before.hits };
+      });
+    return ExpectValue(result, { value: 42, hit: true });
+  },
+  cached_closure_keeps_shared_values_live: () => {
+    const sharedValue = Worklets.createSharedValue(1);
+    const config = { factor: 10 };
+    const f = () => {
+      "worklet";
+      return sharedValue.value * config.factor;
+    };
+    const result = Worklets.defaultContext.runAsync(f).then((first) => {
+      sharedValue.value = 2;
+      return Worklets.defaultContext
+        .runAsync(f)
+        .then((second) => [first, second]);
+    });
+    return ExpectValue(result, [10, 20]);
+  },
+  worklet_captured_by_several_worklets_is_parsed_once: () => {
+    const offset = 5;
+    const add = (a: number) => {
+      "worklet";
+      return a + offset;
+    };
+    const first = () => {
+      "worklet";
+      return add(1);
+    };
+    const second = () => {
+      "worklet";
+      return add(2);
+    };
+    const parsed = () => Worklets.getWorkletCacheStats().parsed;
+    const before = parsed();
+    const result = Worklets.defaultContext.runAsync(first).then((a) => {
+      const afterFirst = parsed();
+      return Worklets.defaultContext.runAsync(second).then((b) => ({
+        results: [a, b],
+        // first and add, then only second
+        parsed: [afterFirst - before, parsed() - afterFirst],
+      }));
+    });
+    return ExpectValue(result, { results: [6, 7], parsed: [2, 1] });
+  },
+  captured_objects_are_copied_once_per_function: () => {
+    const config = { factor: 10 };
+    const f = () => {
+      "worklet";
+      return config.factor;
+    };
+    const result = Worklets.defaultContext.runAsync(f).then((first) => {
+      config.factor = 20;
+      return Worklets.defaultContext
+        .runAsync(f)
+        .then((second) => [first, second]);
+    });
+    return ExpectValue(result, [10, 10]);
+  },
 };
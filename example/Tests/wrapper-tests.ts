@@ -1,5 +1,5 @@
 import { Worklets } from "react-native-worklets-core";
-import { ExpectValue } from "./utils";
+import { ExpectException, ExpectValue } from "./utils";
 
 const convert =
   <T>(value: T): (() => Promise<void>) =>
@@ -14,6 +14,7 @@ export const wrapper_tests = {
   convert_null: convert(null),
   convert_number: convert(123),
   convert_string: convert("abc"),
+  convert_unicode_string: convert("åäö \u{1F600} \0 end"),
   convert_boolean: convert(true),
   convert_object: convert({ a: 123, b: "abc", child: { x: 5, y: 23 } }),
   convert_object_with_children: convert({
@@ -42,12 +43,40 @@ export const wrapper_tests = {
 
   array_get: () => ExpectValue(Worklets.createSharedValue([100]).value[0], 100),
 
+  array_get_out_of_bounds: () =>
+    ExpectValue(Worklets.createSharedValue([100]).value[5], undefined),
+
+  array_at: () => {
+    const array = Worklets.createSharedValue([100, 200, 300]);
+    return ExpectValue([array.value.at(1), array.value.at(-1)], [200, 300]);
+  },
+
+  array_getRange: () => {
+    const array = Worklets.createSharedValue([100, 200, 300, 400]);
+    // @ts-ignore
+    return ExpectValue(array.value.getRange(1, -1), [200, 300]);
+  },
+
   array_set: () => {
     const array = Worklets.createSharedValue([100, 200]);
     array.value[0] = 300;
     return ExpectValue(array.value[0], 300);
   },
 
+  array_set_non_number_in_number_array: () => {
+    const array = Worklets.createSharedValue<unknown[]>([100, 200, 300]);
+    array.value[1] = "abc";
+    array.value.push({ x: 5 });
+    return ExpectValue(array.value, [100, "abc", 300, { x: 5 }]);
+  },
+
+  array_toFloat64Array: () => {
+    const array = Worklets.createSharedValue([1.5, 2, 3]);
+    // @ts-ignore
+    const typed: Float64Array = array.value.toFloat64Array();
+    return ExpectValue(Array.from(typed), [1.5, 2, 3]);
+  },
+
   array_push: () => {
     const array = Worklets.createSharedValue([100, 200]);
     array.value.push(300);
@@ -108,6 +137,12 @@ export const wrapper_tests = {
     return ExpectValue(array.value[0], 300);
   },
 
+  array_unshift_order: () => {
+    const array = Worklets.createSharedValue([100, 200]);
+    array.value.unshift(300, 500);
+    return ExpectValue(array.value, [300, 500, 100, 200]);
+  },
+
   array_unshift_length: () => {
     const array = Worklets.createSharedValue([100, 200]);
     array.value.unshift(300, 500);
@@ -299,6 +334,217 @@ export const wrapper_tests = {
     return ExpectValue(array.value.indexOf(900), -1);
   },
 
+  array_includes_compares_types: () => {
+    const array = Worklets.createSharedValue<unknown[]>([1, "2", NaN, null]);
+    return ExpectValue(
+      [
+        array.value.includes("1"),
+        array.value.includes(2),
+        array.value.includes(NaN),
+        array.value.indexOf(NaN),
+        array.value.indexOf(null),
+      ],
+      [false, false, true, -1, 3]
+    );
+  },
+
+  array_includes_with_value_index: () => {
+    const array = Worklets.createSharedValue<unknown[]>([100, "abc"]);
+    // @ts-ignore
+    array.value.enableValueIndex();
+    array.value.push(300);
+    array.value[0] = 400;
+    array.value.shift();
+    return ExpectValue(
+      [
+        array.value.includes(100),
+        array.value.includes(400),
+        array.value.includes("abc"),
+        array.value.includes(300),
+      ],
+      [false, false, true, true]
+    );
+  },
+
+  array_splice: () => {
+    const array = Worklets.createSharedValue<unknown[]>([1, 2, 3, 4]);
+    const removed = array.value.splice(1, 2, "a", "b", "c");
+    return ExpectValue(
+      { removed, array: array.value },
+      { removed: [2, 3], array: [1, "a", "b", "c", 4] }
+    );
+  },
+
+  array_splice_to_end: () => {
+    const array = Worklets.createSharedValue<unknown[]>([1, "a", 3]);
+    const removed = array.value.splice(1, Infinity);
+    return ExpectValue(
+      { removed, array: array.value },
+      { removed: ["a", 3], array: [1] }
+    );
+  },
+
+  array_splice_no_args: () => {
+    const array = Worklets.createSharedValue([1, 2, 3]);
+    const removed = array.value.splice();
+    return ExpectValue({ removed, array: array.value }, {
+      removed: [],
+      array: [1, 2, 3],
+    });
+  },
+
+  array_splice_converts_count: () => {
+    const array = Worklets.createSharedValue([1, 2, 3, 4]);
+    // @ts-ignore
+    const removed = array.value.splice("1", "2");
+    return ExpectValue({ removed, array: array.value }, {
+      removed: [2, 3],
+      array: [1, 4],
+    });
+  },
+
+  array_fill_primitives_change_independently: () => {
+    const array = Worklets.createSharedValue<unknown[]>(["a", "b", "c"]);
+    array.value.fill("x");
+    array.value[0] = "y";
+    return ExpectValue(array.value, ["y", "x", "x"]);
+  },
+
+  array_slice: () => {
+    const array = Worklets.createSharedValue([1, 2, 3, 4]);
+    return ExpectValue(array.value.slice(-3, 3), [2, 3]);
+  },
+
+  array_reverse: () => {
+    const array = Worklets.createSharedValue([1, "2", 3]);
+    array.value.reverse();
+    return ExpectValue(array.value, [3, "2", 1]);
+  },
+
+  array_fill: () => {
+    const array = Worklets.createSharedValue([1, 2, 3, 4]);
+    array.value.fill(0, 1, 3);
+    return ExpectValue(array.value, [1, 0, 0, 4]);
+  },
+
+  array_sort_default_order: () => {
+    const array = Worklets.createSharedValue<unknown[]>([10, 9, 1, -2]);
+    array.value.sort();
+    const strings = Worklets.createSharedValue(["b", undefined, "a", "C"]);
+    strings.value.sort();
+    return ExpectValue(
+      [array.value, strings.value],
+      [
+        [-2, 1, 10, 9],
+        ["C", "a", "b", undefined],
+      ]
+    );
+  },
+
+  array_sort_comparator: () => {
+    const array = Worklets.createSharedValue([1, 10, -2, 9]);
+    array.value.sort((a, b) => b - a);
+    return ExpectValue(array.value, [10, 9, 1, -2]);
+  },
+
+  array_sort_random_comparator: () => {
+    const values = Array.from({ length: 200 }, (_, i) => i);
+    const array = Worklets.createSharedValue(values);
+    array.value.sort(() => Math.random() - 0.5);
+    array.value.sort(() => NaN);
+    const sorted = [...array.value].sort((a, b) => a - b);
+    return ExpectValue(sorted, values);
+  },
+
+  array_sort_rejects_modification_by_comparator: () => {
+    const array = Worklets.createSharedValue([3, 1, 2]);
+    return ExpectException(() =>
+      array.value.sort((a, b) => {
+        array.value.push(0);
+        return a - b;
+      })
+    );
+  },
+
+  array_sort_comparator_in_worklet: () => {
+    const array = Worklets.createSharedValue([{ x: 3 }, { x: 1 }, { x: 2 }]);
+    const w = Worklets.defaultContext.createRunAsync(() => {
+      "worklet";
+      array.value.sort((a, b) => a.x - b.x);
+      return array.value.map((p) => p.x);
+    });
+    return ExpectValue(w(), [1, 2, 3]);
+  },
+
+  map_get_set_delete: () => {
+    const map = Worklets.createSharedValue(
+      new Map<unknown, unknown>([
+        ["a", 1],
+        [2, { b: 3 }],
+      ])
+    );
+    map.value.set(-0, "zero");
+    map.value.delete("a");
+    return ExpectValue(
+      [map.value.size, map.value.get(0), map.value.has("a"), map.value.get(2)],
+      [2, "zero", false, { b: 3 }]
+    );
+  },
+
+  map_for_each_in_insertion_order: () => {
+    const map = Worklets.createSharedValue(
+      new Map([
+        ["z", 1],
+        ["a", 2],
+      ])
+    );
+    const keys: string[] = [];
+    map.value.forEach((_, key) => keys.push(key));
+    return ExpectValue(keys, ["z", "a"]);
+  },
+
+  map_for_each_requires_callback: () => {
+    const map = Worklets.createSharedValue(new Map([["a", 1]]));
+    return ExpectException(
+      () => (map.value as any).forEach(),
+      "Map.prototype.forEach expects a function."
+    );
+  },
+
+  set_for_each_with_primitive_this_arg: () => {
+    const set = Worklets.createSharedValue(new Set([1, 2]));
+    let calls = 0;
+    set.value.forEach(() => calls++, null);
+    set.value.forEach(() => calls++, 0);
+    return ExpectValue(calls, 4);
+  },
+
+  map_argument_is_copied_to_map: () => {
+    const w = Worklets.defaultContext.createRunAsync((m: Map<string, number>) => {
+      "worklet";
+      return m instanceof Map ? m.get("b") : undefined;
+    });
+    return ExpectValue(w(new Map([["b", 4]])), 4);
+  },
+
+  set_add_has_delete: () => {
+    const set = Worklets.createSharedValue(new Set<unknown>([1, "1"]));
+    const w = Worklets.defaultContext.createRunAsync(() => {
+      "worklet";
+      set.value.add(NaN);
+      set.value.add(1);
+      set.value.delete("1");
+      return [set.value.size, set.value.has(NaN), set.value.has("1")];
+    });
+    return ExpectValue(w(), [2, true, false]);
+  },
+
+  map_with_object_keys_throws: () => {
+    return ExpectException(() =>
+      Worklets.createSharedValue(new Map([[{}, 1]]))
+    );
+  },
+
   array_join: () => {
     const array = Worklets.createSharedValue([100, 200]);
     return ExpectValue(array.value.join(), "100,200");
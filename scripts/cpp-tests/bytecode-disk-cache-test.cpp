@@ -0,0 +1,160 @@
+// Host test of the bytecode disk cache, run with scripts/cpp-tests/run.sh
+
+#include "WKTJsiBytecodeDiskCache.h"
+
+#include <dirent.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+using RNWorklet::JsiBytecodeDiskCache;
+
+namespace {
+
+int failures = 0;
+
+#define CHECK(condition)                                                       \
+  do {                                                                         \
+    if (!(condition)) {                                                        \
+      std::fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__,    \
+                   #condition);                                                \
+      failures++;                                                              \
+    }                                                                          \
+  } while (false)
+
+const char *Source = "function () { return 42; }";
+const char *Bytecode = "\x01\x02\x03 compiled bytecode";
+const uint32_t EngineVersion = 96;
+
+/**
+ Returns the paths of the entries in the directory
+ */
+std::vector<std::string> listEntries(const std::string &directory) {
+  std::vector<std::string> entries;
+  auto dir = opendir(directory.c_str());
+  while (auto entry = readdir(dir)) {
+    std::string name = entry->d_name;
+    if (name.size() > 4 && name.compare(name.size() - 4, 4, ".wbc") == 0) {
+      entries.push_back(directory + "/" + name);
+    }
+  }
+  closedir(dir);
+  return entries;
+}
+
+std::string onlyEntry(const std::string &directory) {
+  auto entries = listEntries(directory);
+  CHECK(entries.size() == 1);
+  return entries.empty() ? "" : entries[0];
+}
+
+bool loads(JsiBytecodeDiskCache &cache, double hash, const char *source) {
+  auto buffer = cache.load(hash, source, EngineVersion);
+  if (buffer == nullptr) {
+    return false;
+  }
+  std::string bytes(reinterpret_cast<const char *>(buffer->data()),
+                    buffer->size());
+  CHECK(bytes == Bytecode);
+  return true;
+}
+
+void testDisabled(JsiBytecodeDiskCache &cache) {
+  cache.setDirectory("");
+  CHECK(!cache.isEnabled());
+  CHECK(!cache.store(1, Source, EngineVersion, Bytecode));
+  CHECK(cache.load(1, Source, EngineVersion) == nullptr);
+}
+
+void testHitAndMiss(JsiBytecodeDiskCache &cache, const std::string &directory) {
+  auto before = cache.getStats();
+  CHECK(!loads(cache, 1, Source));
+  CHECK(cache.store(1, Source, EngineVersion, Bytecode));
+  CHECK(loads(cache, 1, Source));
+  CHECK(cache.load(1, Source, EngineVersion + 1) == nullptr);
+  auto stats = cache.getStats();
+  CHECK(stats.hits - before.hits == 1);
+  CHECK(stats.misses - before.misses == 2);
+  CHECK(stats.writes - before.writes == 1);
+  CHECK(stats.invalid == before.invalid);
+  std::remove(onlyEntry(directory).c_str());
+}
+
+void testStale(JsiBytecodeDiskCache &cache, const std::string &directory) {
+  CHECK(cache.store(2, Source, EngineVersion, Bytecode));
+  auto before = cache.getStats();
+  CHECK(!loads(cache, 2, "function () { return 43; }"));
+  CHECK(cache.getStats().invalid - before.invalid == 1);
+  CHECK(listEntries(directory).empty());
+}
+
+void testCorrupt(JsiBytecodeDiskCache &cache, const std::string &directory) {
+  CHECK(cache.store(3, Source, EngineVersion, Bytecode));
+  auto path = onlyEntry(directory);
+  auto file = std::fopen(path.c_str(), "r+b");
+  std::fseek(file, -1, SEEK_END);
+  std::fputc('!', file);
+  std::fclose(file);
+  auto before = cache.getStats();
+  CHECK(!loads(cache, 3, Source));
+  CHECK(cache.getStats().invalid - before.invalid == 1);
+  CHECK(listEntries(directory).empty());
+}
+
+void testTruncated(JsiBytecodeDiskCache &cache, const std::string &directory) {
+  // Truncated inside the bytecode, then inside the header
+  for (auto size : {70, 10}) {
+    CHECK(cache.store(4, Source, EngineVersion, Bytecode));
+    auto path = onlyEntry(directory);
+    CHECK(truncate(path.c_str(), size) == 0);
+    auto before = cache.getStats();
+    CHECK(!loads(cache, 4, Source));
+    CHECK(cache.getStats().invalid - before.invalid == 1);
+    CHECK(listEntries(directory).empty());
+  }
+}
+
+void testHashesOutsideIntegerRange(JsiBytecodeDiskCache &cache,
+                                   const std::string &directory) {
+  std::vector<double> hashes = {-1, 0.5, 1e300, -1e300};
+  for (auto hash : hashes) {
+    CHECK(cache.store(hash, Source, EngineVersion, Bytecode));
+  }
+  CHECK(listEntries(directory).size() == hashes.size());
+  for (auto hash : hashes) {
+    CHECK(loads(cache, hash, Source));
+  }
+  for (auto &path : listEntries(directory)) {
+    std::remove(path.c_str());
+  }
+}
+
+} // namespace
+
+int main() {
+  char directoryTemplate[] = "/tmp/wkt-bytecode-test-XXXXXX";
+  auto directory = mkdtemp(directoryTemplate);
+  if (directory == nullptr) {
+    std::perror("mkdtemp");
+    return 1;
+  }
+
+  auto &cache = JsiBytecodeDiskCache::getInstance();
+  testDisabled(cache);
+  cache.setDirectory(directory);
+  testHitAndMiss(cache, directory);
+  testStale(cache, directory);
+  testCorrupt(cache, directory);
+  testTruncated(cache, directory);
+  testHashesOutsideIntegerRange(cache, directory);
+  rmdir(directory);
+
+  if (failures > 0) {
+    std::fprintf(stderr, "%d checks failed\n", failures);
+    return 1;
+  }
+  std::printf("Bytecode disk cache tests passed\n");
+  return 0;
+}
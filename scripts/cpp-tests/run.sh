@@ -0,0 +1,13 @@
+#!/bin/sh
+# Builds and runs the native host tests on Linux or macOS
+set -e
+
+ROOT="$(cd "$(dirname "$0")/../.." && pwd)"
+JSI="${JSI_DIR:-$ROOT/node_modules/react-native/ReactCommon/jsi}"
+OUT="$(mktemp -d)"
+trap 'rm -rf "$OUT"' EXIT
+
+${CXX:-c++} -std=c++17 -Wall -I"$JSI" -I"$ROOT/cpp" \
+  "$ROOT/scripts/cpp-tests/bytecode-disk-cache-test.cpp" "$JSI/jsi/jsi.cpp" \
+  -o "$OUT/bytecode-disk-cache-test"
+"$OUT/bytecode-disk-cache-test"
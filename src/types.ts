@@ -8,7 +8,257 @@
 export interface ISharedValue<T> {
   get value(): T;
   set value(v: T);
-  addListener(listener: () => void): () => void;
+  /**
+   * Increases every time the value or one of its children changes. Reading
+   * the version takes no lock.
+   */
+  get version(): number;
+  /**
+   * Returns the value and its version if the version is greater than the
+   * given version, otherwise undefined without reading the value. Pass the
+   * returned version to the next call, the value is at least as new as it.
+   */
+  valueIfChanged(
+    sinceVersion: number
+  ): { value: T; version: number } | undefined;
+  /**
+   * Adds a listener that is called when the value changes. Changes are
+   * coalesced: the listener is scheduled once on the thread it was added on and
+   * is called once for all changes made before it runs.
+   * @returns A function that removes the listener.
+   */
+  addListener(listener: () => void, options?: IListenerOptions): () => void;
+  /**
+   * Adds a listener that receives the changes made since it was last called,
+   * with the path from the value to each changed property.
+   * @returns A function that removes the listener.
+   */
+  addListener(
+    listener: (changes: ISharedValueChange[]) => void,
+    options: IListenerOptions & { changes: true }
+  ): () => void;
+  /**
+   * Returns the estimated native memory used by the value.
+   */
+  getMemoryStats(): IMemoryStats;
+  /**
+   * Calls the function while holding the lock of the value, so that other
+   * threads reading through the value see either none or all of its changes.
+   * Nested objects read from the value before the transaction (e.g.
+   * `const pos = sv.value.pos`) are not locked, other threads reading
+   * through them can see some of the changes. Listeners are notified once
+   * after the lock is released. Changes made before the function throws are
+   * kept, there is no rollback.
+   * @returns The return value of the function.
+   */
+  transaction<R>(fn: () => R): R;
+}
+
+/**
+ * Options for adding a listener to a shared value.
+ */
+export interface IListenerOptions {
+  /**
+   * Calls the listener synchronously on the writing thread for every change
+   * instead of coalescing changes.
+   */
+  sync?: boolean;
+  /**
+   * Passes the changes made since the listener was last called to the
+   * listener.
+   */
+  changes?: boolean;
+  /**
+   * Only calls the listener for changes to the property at the path, its
+   * children or its parents. Either keys separated by dots, like
+   * `"items.0.x"`, or an array of keys.
+   */
+  path?: string | (string | number)[];
+}
+
+/**
+ * A change to a shared value. The path is empty when the value itself was
+ * replaced, otherwise it holds the keys from the value to the changed
+ * property.
+ */
+export interface ISharedValueChange {
+  path: (string | number)[];
+  value: unknown;
+}
+
+/**
+ * Counters of the cache of evaluated worklet functions.
+ */
+export interface IWorkletCacheStats {
+  hits: number;
+  misses: number;
+  evictions: number;
+  /**
+   * Number of functions cached in all runtimes.
+   */
+  size: number;
+  /**
+   * Number of functions parsed into worklets. Each function object is parsed
+   * once, however often it is passed to a context.
+   */
+  parsed: number;
+  /**
+   * Counters of the cache of compiled worklet code shared by all runtimes.
+   * Only used on Hermes, other engines evaluate worklet code from source.
+   */
+  prepared: Omit<IWorkletCacheStats, "prepared" | "disk" | "parsed">;
+  /**
+   * Counters of the bytecode directory set with `setBytecodeCacheDirectory`.
+   * Invalid entries are corrupt, truncated or compiled from other source.
+   */
+  disk: { hits: number; misses: number; invalid: number; writes: number };
+}
+
+/**
+ * Estimated native memory used by wrapped values, in bytes and wrapper nodes.
+ */
+export interface IMemoryStats {
+  bytes: number;
+  nodes: number;
+}
+
+/**
+ * Memory used by the values a worklet context holds.
+ */
+export interface IWorkletContextMemoryStats {
+  name: string;
+  /**
+   * Arguments of calls into the context that have not completed yet.
+   */
+  queuedArguments: IMemoryStats;
+  /**
+   * Captured closures of the worklets created for the context.
+   */
+  closures: IMemoryStats;
+}
+
+/**
+ * Native memory used by all shared values and worklet contexts. Memory that
+ * is reachable from several places is counted once, for the first one.
+ */
+export interface IWorkletMemoryStats extends IMemoryStats {
+  sharedValues: IMemoryStats & { count: number };
+  /**
+   * Calls and worklets running on the React-JS thread are counted in the
+   * default context.
+   */
+  contexts: IWorkletContextMemoryStats[];
+}
+
+/**
+ * Options for creating a shared value.
+ */
+export interface ISharedValueOptions {
+  /**
+   * Only wraps the top level of the value up front. Nested objects and arrays
+   * are captured as an immutable JSON snapshot and wrapped the first time they
+   * are accessed, which makes sharing large objects cheap when only a few
+   * fields are read.
+   *
+   * Nested values that JSON cannot represent exactly (functions, `undefined`,
+   * `NaN`, class instances, cycles) are wrapped eagerly instead. Host objects
+   * nested below the top level are not supported in lazy mode.
+   */
+  lazy?: boolean;
+  /**
+   * Wraps objects that are referenced from several places in the value once,
+   * so that the references stay identical. Without it every reference gets
+   * its own copy, only cycles are preserved. Tracking references makes
+   * wrapping objects slower, so only enable it for values that need it.
+   *
+   * Changes made through a shared object notify the listeners of the first
+   * place it was referenced from, and are reported with the path through
+   * that place.
+   */
+  preserveReferences?: boolean;
+}
+
+/**
+ * A value published on one thread and read on another without either
+ * waiting for the other. Readers always get the latest complete value.
+ * Values are copied when published.
+ */
+export interface ITripleBuffer<T> {
+  /**
+   * Number of values published since the buffer was created.
+   */
+  readonly version: number;
+  /**
+   * Publishes a value, replacing the value readers get.
+   */
+  publish(value: T): void;
+  /**
+   * Returns a copy of the latest published value.
+   */
+  read(): T;
+}
+
+/**
+ * A value computed by a worklet from shared values. It is recomputed when it
+ * is read after one of its dependencies changed.
+ */
+export interface IDerivedValue<T> {
+  readonly value: T;
+}
+
+/**
+ * Options for creating a channel.
+ */
+export interface IChannelOptions {
+  /**
+   * Number of values the channel can hold, between 1 and 1048576. Defaults
+   * to 64.
+   */
+  capacity?: number;
+}
+
+/**
+ * A bounded queue of values that can be sent and received from any runtime.
+ * Values are copied when sent.
+ */
+export interface IChannel<T> {
+  readonly capacity: number;
+  /**
+   * Sends a value, waiting for space when the channel is full.
+   */
+  send(value: T): Promise<void>;
+  /**
+   * Sends a value if the channel has space.
+   * @returns False if the channel is full.
+   */
+  trySend(value: T): boolean;
+  /**
+   * Receives the oldest value, waiting for one when the channel is empty.
+   */
+  receive(): Promise<T>;
+  /**
+   * Receives the oldest value if there is one, otherwise returns undefined.
+   */
+  tryReceive(): T | undefined;
+  /**
+   * Receives up to `max` values without waiting, defaults to the capacity.
+   */
+  drain(max?: number): T[];
+}
+
+/**
+ * Options for creating an async worklet function.
+ */
+export interface IRunAsyncOptions {
+  /**
+   * Wraps objects nested in the arguments lazily, see {@linkcode ISharedValueOptions.lazy}.
+   */
+  lazyArguments?: boolean;
+  /**
+   * Wraps objects referenced from several places in the arguments once, see
+   * {@linkcode ISharedValueOptions.preserveReferences}.
+   */
+  preserveArgumentReferences?: boolean;
 }
 
 /**
@@ -66,6 +316,7 @@ export interface IWorkletContext {
    * The resulting function is memoized, so this is merely just a bit more efficient than {@linkcode runAsync}.
    * @worklet
    * @param worklet The worklet to run on this Context. It needs to be decorated with the `'worklet'` directive.
+   * @param options Options for wrapping the arguments.
    * @returns A function that can be called to execute the Worklet function on this context.
    * @example
    * ```ts
@@ -76,10 +327,16 @@ export interface IWorkletContext {
    * ```
    */
   createRunAsync: <TArgs extends unknown[], TReturn>(
-    worklet: (...args: TArgs) => TReturn
+    worklet: (...args: TArgs) => TReturn,
+    options?: IRunAsyncOptions
   ) => (...args: TArgs) => Promise<TReturn>;
   /**
    * Runs the given Function asynchronously on this Worklet context.
+   *
+   * The values the worklet captures are copied the first time the function is
+   * passed to a context and kept for the lifetime of the function, so later
+   * changes to plain captured objects are not seen. Use shared values or
+   * parameters for state that changes.
    * @worklet
    * @param worklet The worklet to run on this Context. It needs to be decorated with the `'worklet'` directive.
    * @returns A Promise that resolves once the Worklet function has completed executing.
@@ -104,8 +361,38 @@ export interface IWorkletNativeApi {
    *
    * Arrays and Objects are wrapped in C++ Proxies instead of copied by value.
    * Array and Objects reads and writes are thread-safe.
+   *
+   * Maps and Sets with primitive keys are stored natively. Inside a shared value
+   * they provide `get`, `set`, `has`, `delete`, `clear`, `size` and `forEach`,
+   * while `keys`, `values` and `entries` return arrays. Passed to a worklet as an
+   * argument they are copied to a real `Map` or `Set`.
+   */
+  createSharedValue: <T>(
+    value: T,
+    options?: ISharedValueOptions
+  ) => ISharedValue<T>;
+  /**
+   * Creates a channel for streaming values between runtimes.
    */
-  createSharedValue: <T>(value: T) => ISharedValue<T>;
+  createChannel: <T>(options?: IChannelOptions) => IChannel<T>;
+  /**
+   * Creates a triple buffered value for data produced and consumed on
+   * different threads, like per frame state.
+   */
+  createTripleBuffer: <T>(value: T) => ITripleBuffer<T>;
+  /**
+   * Creates a value computed by the worklet from the dependencies. The result
+   * is cached and shared by all readers until a dependency changes. The
+   * worklet runs in the given context, or in the reading runtime if no
+   * context is given. Readers outside of the context get the last value
+   * while it is recomputed in the context, only the first read waits for
+   * the context.
+   */
+  createDerivedValue: <T>(
+    worklet: () => T,
+    dependencies: ISharedValue<any>[],
+    context?: IWorkletContext
+  ) => IDerivedValue<T>;
 
   /**
    * @deprecated This API has been deprecated, use {@linkcode IWorkletContext.createRunAsync()} instead
@@ -161,6 +448,38 @@ export interface IWorkletNativeApi {
    * which are incremented everytime a new Thread calls `getCurrentThreadId()`.
    */
   getCurrentThreadId(): number;
+
+  /**
+   * Returns the estimated native memory used by shared values, queued
+   * arguments and captured closures. Arguments and closures are only counted
+   * while {@linkcode setMemoryStatsEnabled} is on.
+   */
+  getMemoryStats(): IWorkletMemoryStats;
+  /**
+   * Turns on counting the arguments and closures of calls into worklet
+   * contexts in {@linkcode getMemoryStats}. It is off by default since it
+   * costs every call. Only calls and worklets created while it is on are
+   * counted.
+   */
+  setMemoryStatsEnabled(enabled: boolean): void;
+  /**
+   * Returns the counters of the cache of evaluated worklet functions, which
+   * keeps the most recently used functions of each runtime.
+   */
+  getWorkletCacheStats(): IWorkletCacheStats;
+  /**
+   * Sets an existing directory to store compiled worklet bytecode in, so
+   * that later launches load it instead of compiling. Pass null to disable.
+   * Throws if the build has no bytecode cache, which requires Hermes built
+   * with its compiler.
+   */
+  setBytecodeCacheDirectory(path: string | null): void;
+  /**
+   * Calls the function as a transaction on all the given shared values, see
+   * ISharedValue.transaction.
+   * @returns The return value of the function.
+   */
+  batch<R>(sharedValues: ISharedValue<any>[], fn: () => R): R;
   /**
    * Get the default Worklet context.
    */